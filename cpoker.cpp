@@ -0,0 +1,90 @@
+///\file cpoker.cpp
+///\brief Implementation of the C interface (cpoker.h) over the evaluator of poker.h
+
+#include "poker.h"
+#include "cpoker.h"
+
+///\brief The bits of the 52 cards in a mask
+static const CardMask deckBits=0x1FFF1FFF1FFF1FFFUL;
+
+///\brief The mask only holds cards of the deck, between least and most of them
+static bool validCards(CardMask m, int least, int most) {
+    int n=countCards(m);
+    return !(m&~deckBits) && n>=least && n<=most;
+}
+
+///\brief Checks the arguments of the equity functions
+static bool validEquity(CardMask hero, CardMask villain, CardMask board, CardMask dead, int threads, poker_equity_result* result) {
+    return result && threads>=1 && validEquityCards(hero,villain,board,dead);
+}
+
+static void copyTotals(const ShowdownTotals& totals, poker_equity_result* result) {
+    result->wins=totals.wins;
+    result->ties=totals.ties;
+    result->losses=totals.losses;
+}
+
+poker_hand poker_card_mask(int card) {
+    return card>=0 && card<=51 ? cardBit(card) : 0;
+}
+
+int poker_parse(const char* text, poker_hand* hand) {
+    static const CardParser parser;
+    int cards[52];
+    ParseError error;
+    if (!text || !hand) return -1;
+    int n=parser.parse(TextView(text),cards,52,error);
+    if (n<0) return -1-(int)error.position;
+    *hand=0;
+    for (int i=0; i<n; i++)
+        *hand|=cardBit(cards[i]);
+    return n;
+}
+
+int poker_evaluate(poker_hand hand) {
+    return validCards(hand,5,7) ? evalMask(hand) : -1;
+}
+
+int poker_category(int key) {
+    return key>=0 && keyCategory(key)<=8 ? keyCategory(key) : -1;
+}
+
+int poker_compare(poker_hand a, poker_hand b) {
+    if (!validCards(a,5,7) || !validCards(b,5,7)) return -1;
+    return showdown(evalMask(a),evalMask(b));
+}
+
+size_t poker_evaluate_batch(const poker_hand* hands, int* keys, size_t n) {
+    size_t invalid=0;
+    for (size_t i=0; i<n; i++) {
+        keys[i]=poker_evaluate(hands[i]);
+        invalid+=keys[i]<0;
+    }
+    return invalid;
+}
+
+int poker_equity_exact(poker_hand hero, poker_hand villain, poker_hand board, poker_hand dead, int threads,
+    poker_equity_result* result) {
+    if (!validEquity(hero,villain,board,dead,threads,result)) return -1;
+    EquityEnumeration e(hero,villain,board,dead,threads);
+    ShowdownTotals totals=e.run();
+    result->equity=totals.equity();
+    result->width=0;
+    copyTotals(totals,result);
+    return 0;
+}
+
+int poker_equity_estimate(poker_hand hero, poker_hand villain, poker_hand board, poker_hand dead, double width,
+    double seconds, uint64_t seed, int threads, poker_equity_result* result) {
+    if (!validEquity(hero,villain,board,dead,threads,result) || width<0 || seconds<0) return -1;
+    EquitySimulation s(hero,villain,board,dead);
+    s.width=width;
+    s.seconds=seconds;
+    s.seed=seed;
+    s.threads=threads;
+    EquityEstimate e=s.run();
+    result->equity=e.equity;
+    result->width=e.width;
+    copyTotals(e.totals,result);
+    return 0;
+}
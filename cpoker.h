@@ -0,0 +1,74 @@
+///\file cpoker.h
+///\brief C interface of the evaluator, implemented by libpoker.a and libpoker.so
+///
+///Cards are numbered 0 to 51 as rank*4+suit (ranks 0 to 12 from 2 to Ace, suits 0 to 3 as S C D H). A hand is a
+///64 bit mask with bit suit*16+rank set for each of its cards, see poker_card_mask().\n
+///Strength keys order the hands as the rules do: the higher key wins, equal keys tie.\n
+///All the functions are thread safe. Invalid arguments are reported by the return values, never by aborting.
+///Programs linking the static library also need the C++ runtime and pthreads (-lstdc++ -lpthread -lm).
+#ifndef CPOKER_H
+#define CPOKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define POKER_API __attribute__((visibility("default")))
+#else
+#define POKER_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///\brief A set of cards, bit suit*16+rank for each card
+typedef uint64_t poker_hand;
+
+///\brief Result of an equity computation, seen from the hero
+typedef struct {
+    ///share of the pot won by the hero, ties count half
+    double equity;
+    ///width of the confidence interval, 0 for exact results
+    double width;
+    ///showdowns won, tied and lost
+    uint64_t wins, ties, losses;
+} poker_equity_result;
+
+///\brief Mask of card 0 to 51, 0 if the card does not exist
+POKER_API poker_hand poker_card_mask(int card);
+
+///\brief Reads cards like "AS KD XH 2c", returns their number or -1-position of the first error
+POKER_API int poker_parse(const char* text, poker_hand* hand);
+
+///\brief Strength key of the best five card hand of 5 to 7 cards, -1 for an invalid hand
+POKER_API int poker_evaluate(poker_hand hand);
+
+///\brief Category of a strength key: 0 high card to 8 straight flush, -1 for an invalid key
+POKER_API int poker_category(int key);
+
+///\brief Compares two hands of 5 to 7 cards: 1 if a wins, 2 if b wins, 0 for a tie, -1 if a hand is invalid
+POKER_API int poker_compare(poker_hand a, poker_hand b);
+
+///\brief Strength keys of n hands, returns the number of invalid hands (their key is -1)
+POKER_API size_t poker_evaluate_batch(const poker_hand* hands, int* keys, size_t n);
+
+///\brief Exact equity of two hole cards by enumerating all the boards, returns 0 or -1 for invalid arguments
+///
+///villain holds two cards, or is 0 for every possible holding; dead cards are out of the deck. Too many dead cards to
+///complete the board and the holdings are invalid arguments.
+///Preflop against every holding the enumeration takes seconds: prefer poker_equity_estimate().
+POKER_API int poker_equity_exact(poker_hand hero, poker_hand villain, poker_hand board, poker_hand dead, int threads,
+    poker_equity_result* result);
+
+///\brief Equity estimated by simulation until the confidence interval is narrower than width or seconds have passed
+///
+///Returns 0 or -1 for invalid arguments, the result of a seed does not depend on the number of threads without time budget.
+POKER_API int poker_equity_estimate(poker_hand hero, poker_hand villain, poker_hand board, poker_hand dead, double width,
+    double seconds, uint64_t seed, int threads, poker_equity_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,760 +1,443 @@
-///\file poker.cpp
-///\brief Rigorously-specified poker hands comparison
-///
-///Implements the poker game and provides formal specifications of it's rules as described in
-///http://en.wikipedia.org/wiki/List_of_poker_hands#General_rules and http://en.wikipedia.org/wiki/List_of_poker_hands#Standard_ranking
-
-/**\mainpage Poker Project
-
-\author Mauro Baluda (id: 67153101)\n mauro@bglug.it
-
-\section intro_sec 1 Introduction
-
-This project is meant as an exercise in formal specification of software systems.\n
-My goal was to create a system that could compare two poker hands and determine the winner following the rules that can be found in\n
-http://en.wikipedia.org/wiki/List_of_poker_hands#General_rules and http://en.wikipedia.org/wiki/List_of_poker_hands#Standard_ranking
-
-The code presented includes the specification, the documentation and the implementation of the system.\n
-
-\section spec_sec 2 The specification
-To determine which is the higher hand in a match I developed a "signature based method".\n
-Is possible to determine a unique signature for all the hands of the same category simply counting the frequencies of all the distinct ranks that take part in the hand and than sort them in descending order obtaining:\n
-\code
-Straight flush -> 11111
-Four of a kind -> 41
-Full House -> 32
-Flush -> 11111
-Straight -> 11111
-Three of A Kind -> 311
-Two Pair -> 221
-One pair -> 2111
-High Card -> 11111
-\endcode
-Straight flush, Flush, Straight, High Card obtain the same 11111 signature but they can anyway be easily classified looking directly at their cards.\n
-Keeping also track of the ranks that generated those signature makes it very easy to determine the winner between two hands of the same category looking at the leftmost different rank as in the following example:
-\code
-8C 8D 6S 4D 5S -> 21111
-8S 7D 8H 4S 5D -> 21111
-\endcode
-both are "One Pair" so we need to look at the ranks:
-\code
-2-8 1-6 1-5 1-4 (freq-rank)
-2-8 1-7 1-5 1-4 (freq-rank)
-\endcode
-the first different rank is in second position: 6 vs 7 so the second hand wins.\n
-this strategy works for all of the different categories.
-
-\section special_case 2.1 Special Case
-A special case that needs to be addressed is the "low A in Straights" like 5432A, the case is anyway easily recognizable.
-
-\section ambiguities 2.2 Ambiguities
-When is not possible to determine which hand wins the match (all the cards have the same rank but different suit), the specification says that the match result is tie.\n
-It would be possible to rise the computer chances to win on the long run solving this kind of ambiguities in his favor.
-
-\section implementation_sec 3 Implementation
-The specification is written in natural/mathematical language and some times in an OCL-like sintax.\n
-The code is written in c++ using assertions heavily to verify the specifications at runtime thus obtaining a complete Design by Contract programming environment.\n
-All the methods of the program verify their pre and post conditions (unless they are just a duplication of the function itself), all the public methods assert the Class Invariant at begin and end. The constructors verify the Class Invariant just before returning the control.
-
-\subsection using 3.1 Using the program
-The makefile provided is for linux systems but a win32 binary file is included (poker.exe).\n
-The program can be tested from the command line passing as parameters one or two poker hands using the following sintax:
-\code
-Ranks: 2 3 4 5 6 7 8 9 X J Q K A
-Suits: S C D H
-
-example: ./poker XC 2H 3H 4D AS
-example: ./poker 8C 7D 6S 4D 5S   7S 2S 5D 8S 6C
-\endcode
-The system will output the Hand classification and who is the winner.
-
-\section documentation_sec 4 Documentation
-The project and the code documentation was written using doxygen [http://www.stack.nl/~dimitri/doxygen/] a multi-language documentation system.
-
-To generate the documentation you need to use the command 'make doc'.
-*/
-
-// includes
-#include <utility>
-#include <vector>
-#include <algorithm>
-#include <cassert>
-#include <functional>
-#include <iostream>
-
-///\brief Holds the Card value, implements some useful operations
-///\invariant 13 possible values for rank: \f$ 0 \leq rank \leq 12 \f$
-///\code
-///context PlayCard
-///    inv rankRange: 0<=rank<=12
-///\endcode
-///\invariant 3 possible values for suit: \f$ 0 \leq rank \leq 3 \f$
-///\code
-///context PlayCard
-///    inv suitRange: 0<=suit<=3
-///\endcode
-class PlayCard {
-private:
-    ///\brief Asserts the Class Invariant
-    ///
-    ///Used at the beginning and end of every public methods to verify that the Invariant holds
-    void ClassInv() {
-        assert(rank>=0);
-        assert(rank<=12);
-        assert(suit>=0);
-        assert(suit<=3);
-    }
-
-public:
-    ///\brief Holds the rank of the card
-    int rank;
-    ///\brief Holds the suit of the card
-    int suit;
-
-    ///\brief The default Constructor
-    ///
-    ///Makes the Class Invariant hold
-    ///\post \f$ rank=0 \wedge suit=0 \f$
-    ///\code
-    ///context PlayCard::PlayCard(): void
-    ///    post defConstr: rank=0 && suit=0
-    ///\endcode
-    PlayCard() {
-        rank=0;
-        suit=0;
-
-        //check postcondition
-        assert(rank==0);
-        assert(suit==0);
-        ClassInv();//Invariant holds
-    }
-
-    ///\brief The main Constructor
-    ///
-    ///Initialize the Class with parameters and makes the Class Invariant hold
-    ///\pre \f$ 0 \leq r \leq 12 \wedge 0 \leq s \leq 3 \f$
-    ///\code
-    ///context PlayCard::PlayCard(int r, int s): void
-    ///    pre mainConstr: 0<=rank<=12 && 0<=suit<=3
-    ///\endcode
-    ///\post \f$ rank=r \wedge suit=s \f$
-    ///\code
-    ///context PlayCard::PlayCard(int r, int s): void
-    ///    post mainConstr: rank=r && suit=s
-    ///\endcode
-    ///@param[in] r: card rank \n
-    ///@param[in] s: card suit \n
-    PlayCard(int r, int s) {
-        //check preconditions
-        assert(r>=0);
-        assert(r<=12);
-        assert(s>=0);
-        assert(s<=3);
-
-        rank=r;
-        suit=s;
-
-        //check postcondition
-        assert(rank==r);
-        assert(suit==s);
-        ClassInv();//Invariant holds
-    }
-
-    ///\brief Compares 2 card's rank (pure function)
-    ///\post \f$ rank=other.rank \f$
-    ///\code
-    ///context PlayCard::equals(PlayCard: other): boolean
-    ///    post equal: rank=other.rank
-    ///\endcode
-    bool sameRank(PlayCard other) {
-        ClassInv();//Invariant holds
-
-        bool result=(rank==other.rank);
-
-        //check postcondition
-        assert(result==(rank==other.rank));
-        ClassInv();//Invariant holds
-        return result;
-    }
-
-    ///\brief Compares 2 card's suit (pure function)
-    ///\post \f$ suit=other.suit \f$
-    ///\code
-    ///context PlayCard::equals(PlayCard: other): boolean
-    ///    post equal: suit==other.suit
-    ///\endcode
-    bool sameSuit(PlayCard other) {
-        ClassInv();//Invariant holds
-
-        bool result=(suit==other.suit);
-
-        assert(result==(suit==other.suit));//post
-        ClassInv();//Invariant holds
-        return result;
-    }
-
-    ///\brief Compares 2 cards fo equality (pure function)
-    ///\post \f$ rank=other.rank \wedge suit=other.suit \f$
-    ///\code
-    ///context PlayCard::equals(PlayCard: other): boolean
-    ///    post equal: rank==other.rank && suit==other.suit
-    ///\endcode
-    bool equals(PlayCard other) {
-        ClassInv();//Invariant holds
-
-        bool result=(sameSuit(other)&&sameRank(other));
-
-        assert(result==(rank==other.rank && suit==other.suit));//post
-        ClassInv();//Invariant holds
-        return result;
-    }
-
-    ///\brief Print a card value (pure function)
-    ///
-    ///Prints a card on standard output in readable format
-    void print() {
-        ClassInv();//Invariant holds
-
-        char* r="23456789XJQKA";
-        char* s="SCDH";
-        std::cout<<r[rank]<<s[suit]<<" ";
-
-        ClassInv();//Invariant holds
-    }
-};
-
-///\brief Holds the Poker Hand and implements the poker rules
-///\invariant No duplicated cards in the hand: \f$ \forall c1, c2 \in PlayCard, c1 \neq c2 \f$
-///\code
-///context PokerHand
-///    inv nonDuplicateCard: self.cards -> forall(c1:PlayCard, c2:PlayCard | c1!=c2 -> !c1.equals(c2))
-///\endcode
-///\invariant cards are exactly 5
-///\code
-///context PokerHand
-///    inv fiveCards: cards.size()=5
-///\endcode
-///\invariant Possible values for category: \f$ 0 \leq category \leq 8 \f$
-///\code
-///context PokerHand
-///    inv categoryRange: 0<=category<=8
-///\endcode
-///\invariant The cards are sorted descending: \f$ (\forall {1 \leq i \leq 4} , cards_{i-1} \geq cards_i \wedge cards \neq A5432) \vee cards=5432A \f$
-///\code
-///context PokerHand
-///    inv sorted: cardsAreSorted()
-///\endcode
-///\invariant Correct signature: sigfreq contains the frequencies of the different ranks in cards in descending order, sigrank contains the corrispondent rank
-///\code
-///context PokerHand
-///    inv sorted: correctSignature()
-///\endcode
-///\invariant The hand is in the right category
-///\code
-///context PokerHand
-///    inv rightCategory: if isStraightFlush() result=StraightFlush
-///                       else if isFourOfAKind() result=isFourOfAKind
-///                       else if isFullHouse() result=FullHouse
-///                       else if isFlush() result=Flush
-///                       else if isStraight() result=Straight
-///                       else if isThreeOfAKind() result=ThreeOfAKind
-///                       else if isTwoPair() result=TwoPair
-///                       else if isOnePair() result=OnePair
-///                       else result=HighCard
-///\endcode
-class PokerHand {
-private:
-    ///\brief Verify that the Class Invariant holds
-    void ClassInv() {
-        //no duplicate cards
-        for (unsigned int i=0; i<cards.size(); i++)
-            for (unsigned int j=i; j<cards.size(); j++)
-                assert(!(i!=j && cards[i].equals(cards[j])));
-        //number of cards
-        assert(cards.size()==5);
-        //category ranges
-        assert(category>=0);
-        assert(category<=8);
-        //cards are sorted
-        assert(cardsAreSorted());
-        //signature is correct
-        assert(correctSignature());
-        //right category
-        assert(isStraightFlush()||category!=8);
-        assert(isFourOfAKind()||category!=7);
-        assert(isFullHouse()||category!=6);
-        assert(isFlush()||category!=5);
-        assert(isStraight()||category!=4);
-        assert(isThreeOfAKind()||category!=3);
-        assert(isTwoPair()||category!=2);
-        assert(isOnePair()||category!=1);
-        assert(category==0 || isStraightFlush()||isFourOfAKind()||isFullHouse()||isFlush()||isStraight()||isThreeOfAKind()||isTwoPair()||isOnePair());
-    }
-
-    ///\brief check if the cards ar sorted (pure function)
-    ///\post TRUE if the cards are sorted descending: \f$ result=(\forall {1 \leq i \leq 4} , cards_{i-1} \geq cards_i \wedge cards \neq A5432) \vee cards=5432A \f$
-    ///\code
-    ///context PokerHand::cardsAreSorted(): bool
-    ///    post sorted: result = cards==5432A OR (forall 1<=i<=4, cards[i-1]<=cards[i] AND cards!=A5432 THAN result=true)
-    ///\endcode
-    bool cardsAreSorted() {
-        //sorted descending
-        bool sorted=true;
-        for (unsigned int i=1; i<cards.size(); i++)
-            sorted&=cards[i-1].rank>=cards[i].rank;
-        //accept 5432A
-        sorted|=(cards[0].rank==3 && cards[1].rank==2 &&  cards[2].rank==1 && cards[3].rank==0 && cards[4].rank==12);
-        //refuse A5432
-        sorted&=!(cards[0].rank==12 && cards[1].rank==3 &&  cards[2].rank==2 && cards[3].rank==1 && cards[4].rank==0);
-        return sorted;
-    }
-
-    ///\brief sort the cards
-    ///\post The cards are sorted descending: \f$ (\forall {1 \leq i \leq 4} , cards_{i-1} \geq cards_i \wedge cards \neq A5432) \vee cards=5432A \f$
-    ///\code
-    ///context PokerHand::sort(): void
-    ///    post sorted: cardsAreSorted()=TRUE
-    ///\endcode
-    void sort() {
-        //sort descending
-        for (std::vector<PlayCard>::iterator It1=cards.begin(); It1!=cards.end(); It1++)
-            for (std::vector<PlayCard>::iterator It2=It1; It2!=cards.end(); It2++)
-                if (It2->rank > It1->rank) { //unsorted
-                    int tmpr=It2->rank;
-                    It2->rank=It1->rank;
-                    It1->rank=tmpr;
-
-                    int tmps=It2->suit;
-                    It2->suit=It1->suit;
-                    It1->suit=tmps;
-                }
-
-        //transform A5432 in 5432A
-        if (cards[0].rank==12 && cards[1].rank==3 &&  cards[2].rank==2 && cards[3].rank==1 && cards[4].rank==0) {
-            cards.push_back(PlayCard(cards[0].rank,cards[0].suit));
-            cards.erase(cards.begin());
-        }
-
-        assert(cardsAreSorted());//postcondition holds
-    }
-
-    ///\brief check if the signature oh the Hand is correct (pure function)
-    ///\post \f$ result=TRUE \Leftrightarrow \f$
-    ///\post sigfreq holds the frequencies of the different ranks in cards:
-    ///\post \f$ \forall {0 \leq i \leq card.countunique()}, sigfreq_i=cards.count(rank=sigrank_i) \wedge \f$
-    ///\post sigfreq is ordered descending:
-    ///\post \f$ \forall {1 \leq i \leq sigfreq.size()} , sigfreq_{i-1} \geq sigfreq_i \wedge \f$
-    ///\post if two freq are the same, sigrank is ordered by rank descending:
-    ///\post \f$ \forall {1 \leq i \leq sigfreq.size()} (sigfreq_{i-1} = sigfreq_i \Rightarrow sigrank_{i-1} > sigrank_i) \f$
-    bool correctSignature() {
-        bool correct=true;
-        //post1
-
-        //post2-3
-        for (unsigned int i=0; i<sigfreq.size(); i++)
-            for (unsigned int j=i+1; j<sigfreq.size(); j++) {
-                correct&=(sigfreq[i]>=sigfreq[j]);
-                if (sigfreq[i]==sigfreq[j]) correct&=(sigrank[i]>sigrank[j]);
-            }
-
-        return correct;
-    }
-
-    ///\brief calculates the signature
-    ///\post correctSignature()=TRUE
-    ///\code
-    ///context PokerHand::sort(): void
-    ///    post sorted: correctSignature()=TRUE
-    ///\endcode
-    void calcSignature() {
-        //copy cards in sigrank
-        for (unsigned int i=0; i<cards.size(); i++)
-            sigrank.push_back(cards[i].rank);
-
-        //delete duplicates in sigrank
-        sigrank.erase(std::unique(sigrank.begin(), sigrank.end() ), sigrank.end() );
-
-        for (unsigned int i=0; i<sigrank.size(); i++)
-            sigfreq.push_back(0);
-        //compile frequencies
-        for (unsigned int i=0; i<cards.size(); i++)
-            for (unsigned int j=0; j<sigrank.size(); j++)
-                if (cards[i].rank==sigrank[j])
-                    sigfreq[j]++;
-
-        //sort sigfreq and sigranc according to sigfreq descending
-        //for equal freq, sort with descending ranks
-        for (unsigned int i=0; i<sigfreq.size(); i++) {
-            for (unsigned int j=i; j<sigfreq.size(); j++) {
-                if ((sigfreq[i]<sigfreq[j])||((sigfreq[i]==sigfreq[j])&&(sigrank[i]<sigrank[j]))) {
-                    int tmp=sigfreq[i];
-                    sigfreq[i]=sigfreq[j];
-                    sigfreq[j]=tmp;
-
-                    tmp=sigrank[i];
-                    sigrank[i]=sigrank[j];
-                    sigrank[j]=tmp;
-                }
-            }
-        }
-
-        assert(correctSignature());//check postconditions
-    }
-
-    ///\brief The hand is a Straight Flush? (pure function)
-    ///\pre correct Signature
-    ///\code
-    ///context PokerHand::isStraightFlush(): bool
-    ///    pre signature: correctSignature()=TRUE
-    ///\endcode
-    ///\post is Straight and is Flush
-    ///\code
-    ///context PokerHand::isStraightFlush(): bool
-    ///    post straightflush: result=isStraight() AND isFlush()
-    ///\endcode
-    bool isStraightFlush() {
-        assert(correctSignature());//check preconditions
-
-        return (isStraight() && isFlush());
-    };
-
-    ///\brief The hand is Four of a Kind? (pure function)
-    ///\pre correct Signature
-    ///\code
-    ///context PokerHand::isFourOfAKind(): bool
-    ///    pre signature: correctSignature()=TRUE
-    ///\endcode
-    ///\post sigfreq=[4,1]
-    ///\code
-    ///context PokerHand::isFourOfAKind(): bool
-    ///    post isfourofakind: result=sigfreq[0]==4 AND sigfreq[1]==1 and sigfreq.size()=2
-    ///\endcode
-    bool isFourOfAKind() {
-        assert(correctSignature());//check preconditions
-
-        if (sigfreq.size()==2 && sigfreq[0]==4 && sigfreq[1]==1)
-            return true;
-        return false;
-    };
-
-    ///\brief The hand is Full House? (pure function)
-    ///\pre correct Signature
-    ///\code
-    ///context pokerHand::isFullHouse(): bool
-    ///    pre signature: correctSignature()=TRUE
-    ///\endcode
-    ///\post sigfreq=[4,1]
-    ///\code
-    ///context pokerHand::isFullHouse(): bool
-    ///    post isfullhouse: result=sigfreq[0]==3 AND sigfreq[1]==2 and sigfreq.size()=2
-    ///\endcode
-    bool isFullHouse() {
-        assert(correctSignature());//check preconditions
-
-        if (sigfreq.size()==2 && sigfreq[0]==3 && sigfreq[1]==2)
-            return true;
-        return false;
-    };
-
-    ///\brief The hand is Flush (pure function)
-    ///\post same suit: \f$ result=TRUE \Leftrightarrow \forall {1 \leq i \leq cards.size()} , cards_{i}.suit = cards_0.suit \f$
-    bool isFlush() {
-        bool result=true;
-        for (unsigned int i=0; i<cards.size(); i++)
-            result&=(cards[i].suit==cards[0].suit);
-
-        return result;
-    };
-
-    ///\brief The hand is Straight (pure function)
-    ///\pre sorted cards
-    ///\code
-    ///context pokerHand::isStraight(): bool
-    ///    pre isstraight: cardsAreSorted()
-    ///\endcode
-    ///\post isstraight: \f$ result=TRUE \Leftrightarrow \f$
-    ///\post \f$ \forall {1 \leq i \leq cards.size()} , cards_{i}.suit+1 = cards_{i-1}.suit \vee cards=5432A \f$
-    bool isStraight() {
-        assert(cardsAreSorted());//check preconditions
-
-        bool result=true;
-        for (unsigned int i=1;i<cards.size();i++)
-            result&=(cards[i].rank+1==cards[i-1].rank);
-
-        //special case (low A)
-        if (cards[0].rank==3 && cards[1].rank==2 &&  cards[2].rank==1 && cards[3].rank==0 && cards[4].rank==12)
-            result=true;
-
-        return result;
-    };
-
-    ///\brief The hand is Three of A Kind? (pure function)
-    ///\pre correct Signature
-    ///\code
-    ///context pokerHand::isThreeOfAKind(): bool
-    ///    pre signature: correctSignature()=TRUE
-    ///\endcode
-    ///\post sigfreq=[3,1,1]
-    ///\code
-    ///context pokerHand::isThreeOfAKind(): bool
-    ///    post isthreeofakind: result=sigfreq[0]==3 AND sigfreq[1]==1 AND sigfreq[2]==1 AND sigfreq.size()=3
-    ///\endcode
-    bool isThreeOfAKind() {
-        assert(correctSignature());//check preconditions
-
-        if (sigfreq.size()==3 && sigfreq[0]==3 && sigfreq[1]==1 && sigfreq[2]==1)
-            return true;
-        return false;
-    };
-
-    ///\brief The hand is Two Pair? (pure function)
-    ///\pre correct Signature
-    ///\code
-    ///context pokerHand::isTwoPair(): bool
-    ///    pre signature: correctSignature()=TRUE
-    ///\endcode
-    ///\post sigfreq=[2,2,1]
-    ///\code
-    ///context pokerHand::isTwoPair(): bool
-    ///    post istwopair: result=sigfreq[0]==2 AND sigfreq[1]==2 AND sigfreq[1]==1 AND sigfreq.size()=3
-    ///\endcode
-    bool isTwoPair() {
-        assert(correctSignature());//check preconditions
-
-        if (sigfreq.size()==3 && sigfreq[0]==2 && sigfreq[1]==2 && sigfreq[2]==1)
-            return true;
-        return false;
-    };
-
-    ///\brief The hand is One Pair? (pure function)
-    ///\pre correct Signature
-    ///\code
-    ///context pokerHand::isOnePair(): bool
-    ///    pre signature: correctSignature()=TRUE
-    ///\endcode
-    ///\post sigfreq=[2,1,1,1]
-    ///\code
-    ///context pokerHand::isOnePair(): bool
-    ///    post isonepair: result=sigfreq[0]==2 AND sigfreq[1]==1 AND sigfreq[2]==1 AND sigfreq[3]==1 AND sigfreq.size()=4
-    ///\endcode
-    bool isOnePair() {
-        assert(correctSignature());//check preconditions
-
-        if (sigfreq.size()==4 && sigfreq[0]==2 && sigfreq[1]==1 && sigfreq[2]==1 && sigfreq[3]==1)
-            return true;
-        return false;
-    };
-
-    ///\brief Best hand inside the same category (pure function)
-    ///\pre correct Signature
-    ///\code
-    ///context pokerHand::betterCards(): bool
-    ///    pre signature: correctSignature()=TRUE
-    ///\endcode
-    ///\post Best straight: \f$ (category=8 \vee category=4) \Rightarrow \f$
-    ///\post \f$ (cards[0].rank = other.cards[0] \Rightarrow result=0) \vee \f$
-    ///\post \f$ (cards[0].rank > other.cards[0] \Rightarrow result=1) \vee \f$
-    ///\post \f$ (cards[0].rank < other.cards[0] \Rightarrow result=2) \f$
-    ///\post Best non straight: \f$ (category \neq 8 \wedge category \neq 4) \Rightarrow \f$
-    ///\post \f$ imin=min(i) \mid sigrank[i] \neq other.sigrank[i] \f$
-    ///\post \f$ \neg \exists imin \Rightarrow result=0 \f$
-    ///\post \f$ sigrank[imin] > other.sigrank[imin] \Rightarrow result=1 \f$
-    ///\post \f$ sigrank[imin] < other.sigrank[imin] \Rightarrow result=2 \f$
-    ///\post the first different rank in sigrank decides all
-    int betterCards(PokerHand other) {
-        assert(correctSignature());//check preconditions
-
-        if (category==8 || category==4) { //straights
-            if (cards[0].rank==other.cards[0].rank) return 0;
-            else if (cards[0].rank>other.cards[0].rank) return 1;
-            else return 2;
-        } else {
-            for (unsigned int i=0;i<sigrank.size();i++) {
-                if (sigrank[i]>other.sigrank[i]) return 1;
-                else if (sigrank[i]<other.sigrank[i]) return 2;
-            }
-            return 0;
-        }
-        return true;
-    }
-
-public:
-    ///the cards in the hand
-    std::vector<PlayCard> cards;
-
-    ///the "signature" of the hand
-    std::vector<int> sigfreq;
-    std::vector<int> sigrank;
-
-    ///the category of the hand
-    int category;
-
-    ///\brief Inizialize the Hand with parameters and finds out it's category
-    ///
-    ///makes the Class invariant hold
-    ///@param[in] r1 r2 r3 r4 r5 : card ranks \n
-    ///@param[in] s1 s2 s3 s4 s5 : card suits \n
-    ///\pre \f$ \forall i, 0 \leq r_i \leq 12 \wedge 0 \leq s_i \leq 3 \f$
-    ///\code
-    ///context PlayCard::PlayCard(int r, int s): void
-    ///    pre mainConstr: 0<=rank<=12 && 0<=suit<=3
-    ///\endcode
-    PokerHand(int r1, int s1, int r2, int s2, int r3, int s3, int r4, int s4, int r5, int s5) {
-        cards.push_back(PlayCard(r1,s1));
-        cards.push_back(PlayCard(r2,s2));
-        cards.push_back(PlayCard(r3,s3));
-        cards.push_back(PlayCard(r4,s4));
-        cards.push_back(PlayCard(r5,s5));
-        //sort the cards
-        sort();
-        //calculating the signature
-        calcSignature();
-        //find the right category
-        if (isStraightFlush()) category=8;
-        else if (isFourOfAKind()) category=7;
-        else if (isFullHouse()) category=6;
-        else if (isFlush()) category=5;
-        else if (isStraight()) category=4;
-        else if (isThreeOfAKind()) category=3;
-        else if (isTwoPair()) category=2;
-        else if (isOnePair()) category=1;
-        else category=0;
-        ClassInv();//Invariant holds
-    }
-
-    ///\brief returns the hand category (pure function)
-    ///\post result=category
-    int getCategory() {
-        ClassInv();//Invariant holds
-        return category;
-        ClassInv();//Invariant holds
-    }
-
-    ///\brief Print a hand's cards values and the category (pure function)
-    void print() {
-        ClassInv();//Invariant holds
-
-        char* c[9];
-        c[0]="HighCards";
-        c[1]="OnePair";
-        c[2]="TwoPair";
-        c[3]="ThreeOfAKind";
-        c[4]="Straight";
-        c[5]="Flush";
-        c[6]="FullHouse";
-        c[7]="FourOfAKind";
-        c[8]="StraightFlush";
-
-        for (unsigned int i=0; i<cards.size(); i++)
-            cards[i].print();
-        std::cout<<": "<<c[category]<<std::endl;
-
-        ClassInv();//Invariant holds
-    }
-
-    ///\brief Returns TRUE if the current hand wins over the parameter one (pure function)
-    ///\pre no duplicates in 2 hands: \f$ \forall i,j | 0 < i,j < cards.size(), cards[i] \neq other.cards[j] \f$
-    ///\post \f$ category > other.category \Rightarrow result=1 \f$
-    ///\post \f$ category < other.category \Rightarrow result=2 \f$
-    ///\post \f$ category = other.category \Rightarrow result=batterCards(other) \f$
-    int wins(PokerHand other) {
-        ClassInv();//Invariant holds
-        //no duplicated cards in the 2 hands
-        for (unsigned int i=0; i<cards.size(); i++)
-            for (unsigned int j=0; j<other.cards.size(); j++)
-                assert(!cards[i].equals(other.cards[j]));
-
-        if (category>other.category) return 1;
-        else if (category==other.category)
-            return betterCards(other);
-        else return 2;
-
-        ClassInv();//Invariant holds
-    }
-};
-
-///\brief Just reads input and calls Hand functions
-///
-///@param[in] argc: nuber of parameters on the command line:\n
-///@param[in] argv: holds parameters passed on the commend line:\n
-int main(int argc, char** argv) {
-    // parse command line
-    char* ranks="23456789XJQKA";
-    char* suits="SCDH";
-
-    std::vector<int> par;
-    for (int i=1;i<argc;i++) {
-        for (int j=0;j<13;j++) {
-            if (ranks[j]==argv[i][0]) par.push_back(j);
-        }
-        for (int j=0;j<4;j++) {
-            if (suits[j]==argv[i][1]) par.push_back(j);
-        }
-    }
-
-    bool unique=true;
-    //looking for duplicates
-    for (unsigned int i=0;i<par.size()/2;i++) {
-        for (unsigned int j=i;j<par.size()/2;j++) {
-            if (i!=j && par[2*j]==par[2*i] && par[2*j+1]==par[2*i+1]) {
-                unique=false;
-                std::cout<<"\n*****\nDuplicated playcards!\n*****\n\n";
-            }
-        }
-    }
-
-    if (!unique || (argc!=6 && argc!=11) ||(par.size()!=10 && par.size()!=20)) {
-        std::cout<<"Wrong parameters!\n";
-        std::cout<<"Command line parameters:\n";
-        std::cout<<"five or ten different playcards\n";
-        std::cout<<"Ranks: 2 3 4 5 6 7 8 9 X J Q K A\n";
-        std::cout<<"Suits: S C D H\n\n";
-        std::cout<<"example: ./poker XC 2H 3H 4D AS\n";
-        std::cout<<"example: ./poker 8C 7D 6S 4D 5S   7S 2S 5D 8S 6C\n";
-        exit(0);
-    }
-
-    PokerHand hand=PokerHand(par[0],par[1],par[2],par[3],par[4],par[5],par[6],par[7],par[8],par[9]);
-    hand.print();
-
-    //generating a random hand (non duplicate cards)
-    std::vector<int> par2;
-    srand(time(0));
-    while (par2.size()!=10) {
-        int r=rand()%13;
-        int s=rand()%4;
-        bool unique2=true;
-        //no duplicates in the random hand
-        for (int j=0;j<5;j++) {
-            if (par[2*j]==r && par[2*j+1]==s)
-                unique2=false;
-        }
-        //no duplicates between the hands
-        for (unsigned int j=0;j<par2.size()/2;j++) {
-            if (par2[2*j]==r && par2[2*j+1]==s)
-                unique2=false;
-        }
-        if (unique2) {
-            par2.push_back(r);
-            par2.push_back(s);
-        }
-    }
-
-    int res;
-    if (par.size()==20) { //both Hands from Command Line
-        PokerHand hand2=PokerHand(par[10],par[11],par[12],par[13],par[14],par[15],par[16],par[17],par[18],par[19]);
-        hand2.print();
-        res=hand.wins(hand2);
-    } else { //random second Hand
-        PokerHand hand3=PokerHand(par2[0],par2[1],par2[2],par2[3],par2[4],par2[5],par2[6],par2[7],par2[8],par2[9]);
-        hand3.print();
-        res=hand.wins(hand3);
-    }
-
-    if (res==0) std::cout<<"TIE!\n";
-    if (res==1) std::cout<<"YOU WIN!\n";
-    if (res==2) std::cout<<"YOU LOSE!\n";
-
-    return 0;
-}
-
+///\file poker.cpp
+///\brief Command line program: compares poker hands, computes video poker returns and runs the benchmark
+
+#include "poker.h"
+
+///\brief Training workload of the profile guided build, and benchmark ('make bench')
+///
+///Every section runs a fixed workload drawn from a seed five times, and prints its name, best time, throughput and
+///a checksum of its results: two builds run the same workload when their checksums are equal. scale multiplies the sizes.
+class Benchmark {
+private:
+    ///\brief n distinct random cards not in used, packed in cards
+    static CardMask deal(CounterRng& rng, int n, CardMask used, int* cards) {
+        CardMask m=0;
+        for (int i=0; i<n; ) {
+            int c=rng.below(52);
+            if ((used|m)&cardBit(c)) continue;
+            m|=cardBit(c);
+            cards[i++]=c;
+        }
+        return m;
+    }
+
+    ///\brief PokerHand construction and wins(), on random hands and on hands of every category
+    class ReferenceHands {
+    public:
+        std::vector<int> cards;
+
+        ReferenceHands(CounterRng& rng, int n) {
+            int c[10];
+            for (int i=0; i<n; i++) {
+                CardMask m=deal(rng,5,0,c);
+                deal(rng,5,m,c+5);
+                cards.insert(cards.end(),c,c+10);
+            }
+            //pairs of the rare categories, the opponent random
+            int found[9]={0,0,0,0,0,0,0,0,0};
+            for (int a=0; a<52; a++)
+                for (int b=a+1; b<52; b++)
+                    for (int d=b+1; d<52; d+=3)
+                        for (int e=d+1; e<52; e+=2)
+                            for (int f=e+1; f<52; f+=5) {
+                                int h[5]={a,b,d,e,f};
+                                int k=keyCategory(evaluate<5>(h));
+                                if (k<4 || found[k]>=n/20) continue;
+                                found[k]++;
+                                std::copy(h,h+5,c);
+                                deal(rng,5,CardsMask<5>::of(h),c+5);
+                                cards.insert(cards.end(),c,c+10);
+                            }
+        }
+
+        uint64_t operator()() {
+            uint64_t sum=0;
+            for (size_t i=0; i<cards.size(); i+=10) {
+                const int* c=&cards[i];
+                PokerHand a(cardRank(c[0]),cardSuit(c[0]),cardRank(c[1]),cardSuit(c[1]),cardRank(c[2]),cardSuit(c[2]),
+                    cardRank(c[3]),cardSuit(c[3]),cardRank(c[4]),cardSuit(c[4]));
+                PokerHand b(cardRank(c[5]),cardSuit(c[5]),cardRank(c[6]),cardSuit(c[6]),cardRank(c[7]),cardSuit(c[7]),
+                    cardRank(c[8]),cardSuit(c[8]),cardRank(c[9]),cardSuit(c[9]));
+                sum=sum*31+a.wins(b)*16+a.getCategory();
+            }
+            return sum;
+        }
+
+        double items() const {
+            return cards.size()/10;
+        }
+    };
+
+    ///\brief All the five card hands with evaluate<5>(), counted by category
+    class AllFiveCards {
+    public:
+        uint64_t operator()() {
+            uint64_t count[10]={0,0,0,0,0,0,0,0,0,0};
+            int h[5];
+            for (h[0]=0; h[0]<52; h[0]++)
+                for (h[1]=h[0]+1; h[1]<52; h[1]++)
+                    for (h[2]=h[1]+1; h[2]<52; h[2]++)
+                        for (h[3]=h[2]+1; h[3]<52; h[3]++)
+                            for (h[4]=h[3]+1; h[4]<52; h[4]++)
+                                count[keyCategory(evaluate<5>(h))]++;
+            uint64_t sum=0;
+            for (int k=0; k<10; k++)
+                sum=sum*1000003+count[k];
+            return sum;
+        }
+
+        double items() const {
+            return 2598960;
+        }
+    };
+
+    ///\brief Random seven card hands, one by one with evalMask() or as a batch
+    class SevenCards {
+    public:
+        std::vector<CardMask> masks;
+        HandBatch batch;
+        std::vector<int> keys;
+        bool batched;
+
+        SevenCards(CounterRng& rng, int n, bool batched) : keys(n), batched(batched) {
+            int c[7];
+            for (int i=0; i<n; i++)
+                masks.push_back(deal(rng,7,0,c));
+            batch.append(&masks[0],n);
+        }
+
+        uint64_t operator()() {
+            if (batched)
+                batch.all().evaluate(&keys[0]);
+            else
+                for (size_t i=0; i<masks.size(); i++)
+                    keys[i]=evalMask(masks[i]);
+            uint64_t sum=0;
+            for (size_t i=0; i<keys.size(); i++)
+                sum+=keys[i];
+            return sum;
+        }
+
+        double items() const {
+            return masks.size();
+        }
+    };
+
+    ///\brief Six handed Hold'em showdowns: winners and split pots
+    class Multiway {
+    public:
+        std::vector<CardMask> deals;
+
+        Multiway(CounterRng& rng, int n) {
+            int c[17];
+            for (int i=0; i<n; i++) {
+                CardMask board=deal(rng,5,0,c);
+                deals.push_back(board);
+                CardMask used=board;
+                for (int p=0; p<6; p++) {
+                    CardMask hole=deal(rng,2,used,c);
+                    used|=hole;
+                    deals.push_back(hole);
+                }
+            }
+        }
+
+        uint64_t operator()() {
+            uint64_t sum=0;
+            CardMask hands[6];
+            int keys[6];
+            for (size_t i=0; i<deals.size(); i+=7) {
+                for (int p=0; p<6; p++)
+                    hands[p]=deals[i]|deals[i+1+p];
+                evalBatch(hands,keys,6);
+                int best=0, winners=1;
+                for (int p=1; p<6; p++) {
+                    int r=showdown(keys[p],keys[best]);
+                    if (r==1) {
+                        best=p;
+                        winners=1;
+                    } else if (r==0)
+                        winners++;
+                }
+                sum+=best*8+winners;
+            }
+            return sum;
+        }
+
+        double items() const {
+            return deals.size()/7;
+        }
+    };
+
+    ///\brief Exact equities on flops and simulated preflop equities
+    class Equity {
+    public:
+        std::vector<CardMask> spots;
+        uint64_t samples, showdowns;
+
+        Equity(CounterRng& rng, int n, uint64_t samples) : samples(samples), showdowns(0) {
+            int c[7];
+            for (int i=0; i<n; i++) {
+                CardMask hero=deal(rng,2,0,c);
+                CardMask villain=deal(rng,2,hero,c);
+                spots.push_back(hero);
+                spots.push_back(villain);
+                spots.push_back(deal(rng,3,hero|villain,c));
+            }
+        }
+
+        uint64_t operator()() {
+            uint64_t sum=0;
+            showdowns=0;
+            for (size_t i=0; i<spots.size(); i+=3) {
+                EquityEnumeration e(spots[i],i%2 ? spots[i+1] : 0,spots[i+2],0,1);
+                ShowdownTotals t=e.run();
+                sum=sum*31+t.wins*3+t.ties;
+                showdowns+=t.total();
+            }
+            EquitySimulation s(spots[0],spots[1],0,0);
+            s.width=0;
+            s.maxSamples=samples;
+            EquityEstimate e=s.run();
+            showdowns+=e.totals.total();
+            return sum*31+e.totals.wins;
+        }
+
+        ///\brief Showdowns of the last run
+        double items() const {
+            return showdowns;
+        }
+    };
+
+    ///\brief Omaha, short deck and wild card hands
+    class Variants {
+    public:
+        std::vector<int> omaha;
+        std::vector<CardMask> shortDeck, wild;
+
+        Variants(CounterRng& rng, int n) {
+            int c[9];
+            for (int i=0; i<n; i++) {
+                deal(rng,9,0,c);
+                omaha.insert(omaha.end(),c,c+9);
+                //the 2s to 5s are out of the short deck
+                deal(rng,7,0x000F000F000F000FUL,c);
+                shortDeck.push_back(CardsMask<7>::of(c));
+                wild.push_back(deal(rng,5+i%3,0,c));
+            }
+        }
+
+        uint64_t operator()() {
+            uint64_t sum=0;
+            for (size_t i=0; i<shortDeck.size(); i++) {
+                sum+=evaluateOmaha<4,5>(&omaha[9*i],&omaha[9*i+4]);
+                sum+=evalShortDeck(shortDeck[i]);
+                sum+=evalDeucesWild(wild[i]);
+                if (countCards(wild[i])<7) sum+=evalWild(wild[i],1);
+            }
+            return sum;
+        }
+
+        double items() const {
+            return shortDeck.size();
+        }
+    };
+
+    ///\brief Fixed width lines of seven card hands parsed into a batch
+    class Lines {
+    public:
+        std::string text;
+
+        Lines(CounterRng& rng, int n) {
+            const char* ranks="23456789TJQKA";
+            const char* suits="SCDH";
+            int c[7];
+            for (int i=0; i<n; i++) {
+                deal(rng,7,0,c);
+                for (int j=0; j<7; j++) {
+                    text+=ranks[cardRank(c[j])];
+                    text+=suits[cardSuit(c[j])];
+                    text+=j<6 ? ' ' : '\n';
+                }
+            }
+        }
+
+        uint64_t operator()() {
+            HandBatch batch;
+            ParseError error;
+            long lines=parseHandLines(TextView(text.data(),text.size()),7,1,batch,error);
+            uint64_t sum=lines;
+            for (size_t i=0; i<batch.size(); i++)
+                sum+=batch.mask(i)%1000003;
+            return sum;
+        }
+
+        double items() const {
+            return text.size()/21;
+        }
+    };
+
+    double total;
+
+    ///\brief Runs a section five times, prints the best time
+    template<class Section>
+    void run(const char* name, Section& section) {
+        double best=0;
+        uint64_t sum=0;
+        for (int r=0; r<5; r++) {
+            double start=wallClock();
+            sum=section();
+            double t=wallClock()-start;
+            if (r==0 || t<best) best=t;
+        }
+        printf("%-10s %9.4f %11.1f %08lx%08lx\n",name,best,section.items()/best/1e3,(unsigned long)(sum>>32),(unsigned long)(sum&0xFFFFFFFF));
+        total+=best;
+    }
+
+public:
+    ///\brief Runs all the sections: name, seconds, thousands of items per second, checksum
+    void run(int scale, uint64_t seed) {
+        total=0;
+        CounterRng rng(seed,0);
+        ReferenceHands reference(rng,100000*scale);
+        run("pokerhand",reference);
+        AllFiveCards all;
+        run("allfive",all);
+        SevenCards seven(rng,4000000*scale,false);
+        run("evalmask",seven);
+        SevenCards batch(rng,4000000*scale,true);
+        run("batch",batch);
+        Multiway multiway(rng,500000*scale);
+        run("multiway",multiway);
+        Equity equity(rng,4*scale,200000*scale);
+        run("equity",equity);
+        Variants variants(rng,100000*scale);
+        run("variants",variants);
+        Lines lines(rng,1000000*scale);
+        run("parse",lines);
+        printf("%-10s %9.4f %11s %16s\n","total",total,"-","-");
+    }
+};
+
+///\brief Just reads input and calls Hand functions
+///
+///@param[in] argc: nuber of parameters on the command line:\n
+///@param[in] argv: holds parameters passed on the commend line:\n
+int main(int argc, char** argv) {
+    //rate of the sampled contract checks of release builds
+    if (getenv("POKER_CONTRACT_RATE")) contractRate=atoi(getenv("POKER_CONTRACT_RATE"));
+
+    //training workload and benchmark
+    if (argc>=2 && strcmp(argv[1],"-bench")==0) {
+        Benchmark b;
+        b.run(argc>=3 ? std::max(atoi(argv[2]),1) : 1,argc>=4 ? strtoul(argv[3],0,10) : 1);
+        return 0;
+    }
+
+    //video poker return of a jacks or better paytable
+    if (argc>=2 && strcmp(argv[1],"-return")==0) {
+        if (argc!=11 && argc!=12) {
+            std::cout<<"Command line parameters:\n";
+            std::cout<<"-return pair twopair trips straight flush fullhouse quads straightflush royal [cache]\n\n";
+            std::cout<<"example: ./poker -return 1 2 3 4 6 9 25 50 800 job96.bin\n";
+            exit(0);
+        }
+        Paytable table;
+        table.minPairRank=9;
+        for (int i=1;i<=8;i++)
+            table.pays[i]=atof(argv[i+1]);
+        table.royal=atof(argv[10]);
+
+        DrawStrategy strategy;
+        if (argc<12 || !strategy.load(argv[11],table)) {
+            DrawSolver solver(table,hardwareThreads());
+            strategy.compute(solver,hardwareThreads());
+            if (argc==12 && !strategy.save(argv[11]))
+                std::cout<<"Cannot write "<<argv[11]<<"\n";
+        }
+        printf("Return: %.4f%%\n",100*strategy.expectedReturn());
+        printf("Variance: %.4f\n",strategy.variance());
+        printf("Standard deviation: %.4f\n",sqrt(strategy.variance()));
+        return 0;
+    }
+
+    // parse command line
+    static const CardParser parser;
+    int cards[10];
+    int n=0;
+    bool valid=true;
+    CardMask seen=0;
+    for (int i=1;i<argc && valid;i++) {
+        ParseError error;
+        int k=parser.parse(TextView(argv[i]),cards+n,10-n,error);
+        if (k<0) {
+            std::cout<<"Argument "<<i<<", position "<<error.position<<": "<<error.message<<"\n";
+            valid=false;
+        }
+        //looking for duplicates
+        for (int j=0;j<k;j++) {
+            if (seen&cardBit(cards[n+j])) {
+                valid=false;
+                std::cout<<"\n*****\nDuplicated playcards!\n*****\n\n";
+            }
+            seen|=cardBit(cards[n+j]);
+        }
+        if (k>0) n+=k;
+    }
+
+    if (!valid || (n!=5 && n!=10)) {
+        std::cout<<"Wrong parameters!\n";
+        std::cout<<"Command line parameters:\n";
+        std::cout<<"five or ten different playcards\n";
+        std::cout<<"Ranks: 2 3 4 5 6 7 8 9 X(T) J Q K A\n";
+        std::cout<<"Suits: S C D H (or s c d h)\n\n";
+        std::cout<<"example: ./poker XC 2H 3H 4D AS\n";
+        std::cout<<"example: ./poker 8C 7D 6S 4D 5S   7S 2S 5D 8S 6C\n";
+        std::cout<<"example: ./poker -return 1 2 3 4 6 9 25 50 800 job96.bin\n";
+        exit(0);
+    }
+
+    std::vector<int> par;
+    for (int i=0;i<n;i++) {
+        par.push_back(cardRank(cards[i]));
+        par.push_back(cardSuit(cards[i]));
+    }
+    PokerHand hand=PokerHand(par[0],par[1],par[2],par[3],par[4],par[5],par[6],par[7],par[8],par[9]);
+    hand.print();
+
+    //generating a random hand (non duplicate cards)
+    std::vector<int> par2;
+    std::vector<int> deck;
+    CardMask first=0;
+    for (int j=0;j<5;j++)
+        first|=cardBit(cards[j]);
+    for (int c=0;c<52;c++) {
+        //no duplicates between the hands
+        if (!(first&cardBit(c))) deck.push_back(c);
+    }
+    CounterRng rng(time(0),0);
+    for (int i=0;i<5;i++) {
+        //partial Fisher-Yates shuffle
+        std::swap(deck[i],deck[i+rng.below(deck.size()-i)]);
+        par2.push_back(cardRank(deck[i]));
+        par2.push_back(cardSuit(deck[i]));
+    }
+
+    int res;
+    if (par.size()==20) { //both Hands from Command Line
+        PokerHand hand2=PokerHand(par[10],par[11],par[12],par[13],par[14],par[15],par[16],par[17],par[18],par[19]);
+        hand2.print();
+        res=hand.wins(hand2);
+    } else { //random second Hand
+        PokerHand hand3=PokerHand(par2[0],par2[1],par2[2],par2[3],par2[4],par2[5],par2[6],par2[7],par2[8],par2[9]);
+        hand3.print();
+        res=hand.wins(hand3);
+    }
+
+    if (res==0) std::cout<<"TIE!\n";
+    if (res==1) std::cout<<"YOU WIN!\n";
+    if (res==2) std::cout<<"YOU LOSE!\n";
+
+    return 0;
+}
+
@@ -0,0 +1,4963 @@
+///\file poker.h
+///\brief Rigorously-specified poker hands comparison
+///
+///Implements the poker game and provides formal specifications of it's rules as described in
+///http://en.wikipedia.org/wiki/List_of_poker_hands#General_rules and http://en.wikipedia.org/wiki/List_of_poker_hands#Standard_ranking
+
+/**\mainpage Poker Project
+
+\author Mauro Baluda (id: 67153101)\n mauro@bglug.it
+
+\section intro_sec 1 Introduction
+
+This project is meant as an exercise in formal specification of software systems.\n
+My goal was to create a system that could compare two poker hands and determine the winner following the rules that can be found in\n
+http://en.wikipedia.org/wiki/List_of_poker_hands#General_rules and http://en.wikipedia.org/wiki/List_of_poker_hands#Standard_ranking
+
+The code presented includes the specification, the documentation and the implementation of the system.\n
+
+\section spec_sec 2 The specification
+To determine which is the higher hand in a match I developed a "signature based method".\n
+Is possible to determine a unique signature for all the hands of the same category simply counting the frequencies of all the distinct ranks that take part in the hand and than sort them in descending order obtaining:\n
+\code
+Straight flush -> 11111
+Four of a kind -> 41
+Full House -> 32
+Flush -> 11111
+Straight -> 11111
+Three of A Kind -> 311
+Two Pair -> 221
+One pair -> 2111
+High Card -> 11111
+\endcode
+Straight flush, Flush, Straight, High Card obtain the same 11111 signature but they can anyway be easily classified looking directly at their cards.\n
+Keeping also track of the ranks that generated those signature makes it very easy to determine the winner between two hands of the same category looking at the leftmost different rank as in the following example:
+\code
+8C 8D 6S 4D 5S -> 21111
+8S 7D 8H 4S 5D -> 21111
+\endcode
+both are "One Pair" so we need to look at the ranks:
+\code
+2-8 1-6 1-5 1-4 (freq-rank)
+2-8 1-7 1-5 1-4 (freq-rank)
+\endcode
+the first different rank is in second position: 6 vs 7 so the second hand wins.\n
+this strategy works for all of the different categories.\n
+Frequencies and ranks are packed in 4 bit nibbles of a single 64 bit integer (0x21110 0x86540 for the first hand), so
+comparing two hands of the same category is a single integer comparison.
+
+\section special_case 2.1 Special Case
+A special case that needs to be addressed is the "low A in Straights" like 5432A, the case is anyway easily recognizable.
+
+\section ambiguities 2.2 Ambiguities
+When is not possible to determine which hand wins the match (all the cards have the same rank but different suit), the specification says that the match result is tie.\n
+It would be possible to rise the computer chances to win on the long run solving this kind of ambiguities in his favor.
+
+\section implementation_sec 3 Implementation
+The specification is written in natural/mathematical language and some times in an OCL-like sintax.\n
+The code is written in c++ using assertions heavily to verify the specifications at runtime thus obtaining a complete Design by Contract programming environment.\n
+All the methods of the program verify their pre and post conditions (unless they are just a duplication of the function itself), all the public methods assert the Class Invariant at begin and end. The constructors verify the Class Invariant just before returning the control.\n
+Release builds ('make release', NDEBUG) keep the contract on a sample of the evaluations: one in POKER_CONTRACT_RATE (10000 by default,
+also read from the environment at startup, 0 disables it) is checked against PokerHand and its specification, violations are logged with the hand.
+With a ShadowVerifier installed in shadowVerifier, the evaluating threads only queue the sampled results and a background thread checks them.
+'make test' builds and runs the CppUnit tests of pokertest.cpp, with the optimizer and the assertions: the evaluators are
+checked exhaustively against PokerHand.
+
+\subsection using 3.1 Using the program
+The makefile provided is for linux systems but a win32 binary file is included (poker.exe).\n
+The program can be tested from the command line passing as parameters one or two poker hands using the following sintax:
+\code
+Ranks: 2 3 4 5 6 7 8 9 X(T) J Q K A
+Suits: S C D H (or s c d h)
+
+example: ./poker XC 2H 3H 4D AS
+example: ./poker 8C 7D 6S 4D 5S   7S 2S 5D 8S 6C
+\endcode
+The system will output the Hand classification and who is the winner.
+
+The exact return and variance of a jacks or better video poker paytable under optimal play are computed with
+\code
+./poker -return pair twopair trips straight flush fullhouse quads straightflush royal [cache]
+
+example: ./poker -return 1 2 3 4 6 9 25 50 800 job96.bin
+\endcode
+The optimal strategy is saved to the cache file and read back while the paytable does not change.
+
+'./poker -bench [scale] [seed]' times the main workloads (reference hands, 5 and 7 card evaluation, batches, multiway,
+equity, variants, parsing) and prints a checksum of each section. 'make pgo' builds poker-pgo, profiled on that workload
+with another seed and linked with -flto; 'make bench' reports the speedup of each section over poker-release.
+
+\subsection fast 3.2 Fast evaluation
+PokerHand is the reference implementation of the rules. Tools that evaluate millions of hands (hand strength, potential, ...)
+use evalMask(), a rank-mask evaluator whose strength keys order the hands as PokerHand::wins() does.
+Hand<N> and evaluate<N>() give the same keys for hands whose size is known at compile time (5, 6 or 7 cards),
+OmahaHand and evaluateOmaha() for Omaha layouts.
+Short deck (36 cards, 9876A straight, Flush above FullHouse) is played with the ShortDeck ruleset of PokerHand, evalShortDeck(),
+Hand<N,ShortDeck> and evaluate<N,ShortDeck>().
+Jokers and deuces wild are evaluated by evalWild() and evalDeucesWild(), five of a kind being category 9.
+
+\subsection library 3.3 Library
+'make' also builds libpoker.a and libpoker.so, the evaluator behind the C interface of cpoker.h (evaluation, comparison,
+batches, equity) for servers calling it in process. C++ programs can include poker.h instead, in any number of translation
+units, and link pokerlib.cpp, which defines the globals of poker.h (contract sampling, shadowVerifier) once. It must be
+built with the NDEBUG setting of the program, or the inline functions of poker.h get two definitions: programs built with
+-DNDEBUG link libpoker.a, debug builds compile pokerlib.cpp with their own flags, as poker.cpp, the command line program, does.
+'make python' builds the Python module poker (pokermodule.cpp): poker.evaluate() scores NumPy arrays of card masks or
+packed cards in place, without the GIL, and poker.equity() runs the equity engine.
+
+\section documentation_sec 4 Documentation
+The project and the code documentation was written using doxygen [http://www.stack.nl/~dimitri/doxygen/] a multi-language documentation system.
+
+To generate the documentation you need to use the command 'make doc'.
+*/
+
+#ifndef POKER_H
+#define POKER_H
+
+// includes
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POKER_X86
+#endif
+
+#ifndef POKER_CONTRACT_RATE
+#define POKER_CONTRACT_RATE 10000
+#endif
+
+//the globals are defined once in pokerlib.cpp (libpoker.a)
+
+///\brief One evaluation in contractRate is checked against the full contract, 0 for none (POKER_CONTRACT_RATE of the library build)
+extern unsigned int contractRate;
+///\brief Sampled checks done and contract violations found, by all the threads
+extern uint64_t contractChecks, contractViolations;
+
+///\brief Evaluations of this thread before the next sampled check (0 before the first one)
+extern __thread unsigned int contractCountdown;
+///\brief True while this thread runs a sampled check
+extern __thread bool contractChecking;
+///\brief The hand under check
+extern __thread uint64_t contractHand;
+
+///\brief Logs a violated condition and the hand under check instead of aborting
+inline void contractFailed(const char* condition, int line) {
+    __atomic_add_fetch(&contractViolations,1,__ATOMIC_RELAXED);
+    char cards[64];
+    int n=0;
+    for (int r=12; r>=0; r--)
+        for (int s=0; s<4; s++)
+            if (contractHand>>(s*16+r)&1) {
+                cards[n++]="23456789XJQKA"[r];
+                cards[n++]="SCDH"[s];
+                cards[n++]=' ';
+            }
+    cards[n ? n-1 : 0]=0;
+    fprintf(stderr,"contract violated: %s (line %d) on %s\n",condition,line,cards);
+}
+
+///\brief Checks a condition of the specification
+///
+///Debug builds assert every condition. Release builds (NDEBUG) evaluate them only inside the sampled checks
+///of contractSample(), a violation is logged by contractFailed() and the program goes on.
+#ifdef NDEBUG
+#define contract(condition) ((!contractChecking || (condition)) ? (void)0 : contractFailed(#condition,__LINE__))
+#else
+#define contract(condition) assert(condition)
+#endif
+
+///\brief Resets the countdown after it ran out inside a group of n evaluations, returns the one to check
+inline long contractPick(size_t n) {
+    if (n==0) return -1;
+    if (contractRate==0) {
+        contractCountdown=~0u;
+        return -1;
+    }
+    long i=contractCountdown ? contractCountdown-1 : 0;
+    long left=(long)contractRate-(long)(n-1-i);
+    contractCountdown=left>0 ? left : 1;
+    return i;
+}
+
+///\brief Counts n evaluations of this thread, returns the index of the one to check (0 to n-1), -1 for none
+inline long contractSample(size_t n) {
+    if (contractCountdown>n) {
+        contractCountdown-=n;
+        return -1;
+    }
+    return contractPick(n);
+}
+
+///\brief Samples a call (contractSample(1)) and checks its contract() conditions while the object lives
+///
+///Used by the classes built directly by the user, as PokerHand, whose contracts would not run in release builds
+///otherwise. The state of an enclosing check is restored at the end.
+class SampledCheck {
+private:
+    bool nested;
+    uint64_t nestedHand;
+
+    //not copyable
+    SampledCheck(const SampledCheck&);
+    SampledCheck& operator=(const SampledCheck&);
+
+public:
+    SampledCheck() : nested(contractChecking), nestedHand(contractHand) {
+        if (contractSample(1)>=0) {
+            __atomic_add_fetch(&contractChecks,1,__ATOMIC_RELAXED);
+            contractChecking=true;
+        }
+    }
+
+    ~SampledCheck() {
+        contractChecking=nested;
+        contractHand=nestedHand;
+    }
+
+    ///\brief Sets the hand logged by contractFailed() (bit suit*16+rank of every card), an enclosing check keeps its own
+    void hand(uint64_t cards) {
+        if (!nested) contractHand=cards;
+    }
+};
+
+///\brief Holds the Card value, implements some useful operations
+///\invariant 13 possible values for rank: \f$ 0 \leq rank \leq 12 \f$
+///\code
+///context PlayCard
+///    inv rankRange: 0<=rank<=12
+///\endcode
+///\invariant 3 possible values for suit: \f$ 0 \leq rank \leq 3 \f$
+///\code
+///context PlayCard
+///    inv suitRange: 0<=suit<=3
+///\endcode
+class PlayCard {
+private:
+    ///\brief Asserts the Class Invariant
+    ///
+    ///Used at the beginning and end of every public methods to verify that the Invariant holds
+    void ClassInv() const {
+        contract(rank>=0);
+        contract(rank<=12);
+        contract(suit>=0);
+        contract(suit<=3);
+    }
+
+public:
+    ///\brief Holds the rank of the card
+    int rank;
+    ///\brief Holds the suit of the card
+    int suit;
+
+    ///\brief The default Constructor
+    ///
+    ///Makes the Class Invariant hold
+    ///\post \f$ rank=0 \wedge suit=0 \f$
+    ///\code
+    ///context PlayCard::PlayCard(): void
+    ///    post defConstr: rank=0 && suit=0
+    ///\endcode
+    PlayCard() {
+        rank=0;
+        suit=0;
+
+        //check postcondition
+        contract(rank==0);
+        contract(suit==0);
+        ClassInv();//Invariant holds
+    }
+
+    ///\brief The main Constructor
+    ///
+    ///Initialize the Class with parameters and makes the Class Invariant hold
+    ///\pre \f$ 0 \leq r \leq 12 \wedge 0 \leq s \leq 3 \f$
+    ///\code
+    ///context PlayCard::PlayCard(int r, int s): void
+    ///    pre mainConstr: 0<=rank<=12 && 0<=suit<=3
+    ///\endcode
+    ///\post \f$ rank=r \wedge suit=s \f$
+    ///\code
+    ///context PlayCard::PlayCard(int r, int s): void
+    ///    post mainConstr: rank=r && suit=s
+    ///\endcode
+    ///@param[in] r: card rank \n
+    ///@param[in] s: card suit \n
+    PlayCard(int r, int s) {
+        //check preconditions
+        contract(r>=0);
+        contract(r<=12);
+        contract(s>=0);
+        contract(s<=3);
+
+        rank=r;
+        suit=s;
+
+        //check postcondition
+        contract(rank==r);
+        contract(suit==s);
+        ClassInv();//Invariant holds
+    }
+
+    ///\brief Compares 2 card's rank (pure function)
+    ///\post \f$ rank=other.rank \f$
+    ///\code
+    ///context PlayCard::equals(PlayCard: other): boolean
+    ///    post equal: rank=other.rank
+    ///\endcode
+    bool sameRank(PlayCard other) const {
+        ClassInv();//Invariant holds
+
+        bool result=(rank==other.rank);
+
+        //check postcondition
+        contract(result==(rank==other.rank));
+        ClassInv();//Invariant holds
+        return result;
+    }
+
+    ///\brief Compares 2 card's suit (pure function)
+    ///\post \f$ suit=other.suit \f$
+    ///\code
+    ///context PlayCard::equals(PlayCard: other): boolean
+    ///    post equal: suit==other.suit
+    ///\endcode
+    bool sameSuit(PlayCard other) const {
+        ClassInv();//Invariant holds
+
+        bool result=(suit==other.suit);
+
+        contract(result==(suit==other.suit));//post
+        ClassInv();//Invariant holds
+        return result;
+    }
+
+    ///\brief Compares 2 cards fo equality (pure function)
+    ///\post \f$ rank=other.rank \wedge suit=other.suit \f$
+    ///\code
+    ///context PlayCard::equals(PlayCard: other): boolean
+    ///    post equal: rank==other.rank && suit==other.suit
+    ///\endcode
+    bool equals(PlayCard other) const {
+        ClassInv();//Invariant holds
+
+        bool result=(sameSuit(other)&&sameRank(other));
+
+        contract(result==(rank==other.rank && suit==other.suit));//post
+        ClassInv();//Invariant holds
+        return result;
+    }
+
+    ///\brief Print a card value (pure function)
+    ///
+    ///Prints a card on standard output in readable format
+    void print() const {
+        ClassInv();//Invariant holds
+
+        char* r="23456789XJQKA";
+        char* s="SCDH";
+        std::cout<<r[rank]<<s[suit]<<" ";
+
+        ClassInv();//Invariant holds
+    }
+};
+
+///\brief Rules of the game: the deck and the order of the categories
+///
+///ShortDeck (6+ Hold'em) removes the 2s to 5s (36 cards), the Ace plays low in 9876A and Flush ranks above FullHouse.
+enum Ruleset { StandardDeck, ShortDeck };
+
+///\brief Position of a category in the order of a ruleset (pure function)
+///
+///Swaps Flush (5) and FullHouse (6) in short deck, the map is its own inverse.
+inline int categoryOrder(int category, Ruleset rules) {
+    if (rules==ShortDeck && (category==5 || category==6)) return 11-category;
+    return category;
+}
+
+///\brief Holds the Poker Hand and implements the poker rules
+///\invariant No duplicated cards in the hand: \f$ \forall c1, c2 \in PlayCard, c1 \neq c2 \f$
+///\code
+///context PokerHand
+///    inv nonDuplicateCard: self.cards -> forall(c1:PlayCard, c2:PlayCard | c1!=c2 -> !c1.equals(c2))
+///\endcode
+///\invariant cards are exactly 5
+///\code
+///context PokerHand
+///    inv fiveCards: cards.size()=5
+///\endcode
+///\invariant Short deck hands hold no 2 to 5: \f$ rules=ShortDeck \Rightarrow \forall i, cards_i.rank \geq 4 \f$
+///\invariant Possible values for category: \f$ 0 \leq category \leq 8 \f$
+///\code
+///context PokerHand
+///    inv categoryRange: 0<=category<=8
+///\endcode
+///\invariant The cards are sorted descending: \f$ (\forall {1 \leq i \leq 4} , cards_{i-1} \geq cards_i \wedge cards \neq A5432) \vee cards=5432A \f$ (9876A in short deck)
+///\code
+///context PokerHand
+///    inv sorted: cardsAreSorted()
+///\endcode
+///\invariant Correct signature: the signature holds the frequencies of the different ranks in cards in descending order and the corrispondent ranks
+///\code
+///context PokerHand
+///    inv sorted: correctSignature()
+///\endcode
+///\invariant The hand is in the right category
+///\code
+///context PokerHand
+///    inv rightCategory: if isStraightFlush() result=StraightFlush
+///                       else if isFourOfAKind() result=isFourOfAKind
+///                       else if isFullHouse() result=FullHouse
+///                       else if isFlush() result=Flush
+///                       else if isStraight() result=Straight
+///                       else if isThreeOfAKind() result=ThreeOfAKind
+///                       else if isTwoPair() result=TwoPair
+///                       else if isOnePair() result=OnePair
+///                       else result=HighCard
+///\endcode
+class PokerHand {
+private:
+    ///\brief Verify that the Class Invariant holds
+    void ClassInv() const {
+        //no duplicate cards
+        for (unsigned int i=0; i<cards.size(); i++)
+            for (unsigned int j=i; j<cards.size(); j++)
+                contract(!(i!=j && cards[i].equals(cards[j])));
+        //number of cards
+        contract(cards.size()==5);
+        //cards in the deck
+        for (unsigned int i=0; i<cards.size(); i++)
+            contract(rules==StandardDeck || cards[i].rank>=4);
+        //category ranges
+        contract(category>=0);
+        contract(category<=8);
+        //cards are sorted
+        contract(cardsAreSorted());
+        //signature is correct
+        contract(correctSignature());
+        //right category
+        contract(isStraightFlush()||category!=8);
+        contract(isFourOfAKind()||category!=7);
+        contract(isFullHouse()||category!=6);
+        contract(isFlush()||category!=5);
+        contract(isStraight()||category!=4);
+        contract(isThreeOfAKind()||category!=3);
+        contract(isTwoPair()||category!=2);
+        contract(isOnePair()||category!=1);
+        contract(category==0 || isStraightFlush()||isFourOfAKind()||isFullHouse()||isFlush()||isStraight()||isThreeOfAKind()||isTwoPair()||isOnePair());
+    }
+
+    ///\brief The cards as bits suit*16+rank, for the hand logged by a failed check (pure function)
+    uint64_t cardBits() const {
+        uint64_t bits=0;
+        for (unsigned int i=0; i<cards.size(); i++)
+            bits|=(uint64_t)1<<(cards[i].suit*16+cards[i].rank);
+        return bits;
+    }
+
+    ///\brief check if the cards ar sorted (pure function)
+    ///\post TRUE if the cards are sorted descending: \f$ result=(\forall {1 \leq i \leq 4} , cards_{i-1} \geq cards_i \wedge cards \neq A5432) \vee cards=5432A \f$
+    ///\code
+    ///context PokerHand::cardsAreSorted(): bool
+    ///    post sorted: result = cards==5432A OR (forall 1<=i<=4, cards[i-1]<=cards[i] AND cards!=A5432 THAN result=true)
+    ///\endcode
+    bool cardsAreSorted() const {
+        //sorted descending
+        bool sorted=true;
+        for (unsigned int i=1; i<cards.size(); i++)
+            sorted&=cards[i-1].rank>=cards[i].rank;
+        //accept 5432A
+        sorted|=isWheel();
+        //refuse A5432
+        sorted&=!isWheelAceHigh();
+        return sorted;
+    }
+
+    ///\brief Rank of the highest card of the straight where the Ace plays low: 5 in 5432A, 9 in short deck 9876A (pure function)
+    int wheelTop() const {
+        return rules==ShortDeck ? 7 : 3;
+    }
+
+    ///\brief The cards are 5432A (9876A in short deck)? (pure function)
+    bool isWheel() const {
+        int w=wheelTop();
+        return cards[0].rank==w && cards[1].rank==w-1 && cards[2].rank==w-2 && cards[3].rank==w-3 && cards[4].rank==12;
+    }
+
+    ///\brief The cards are A5432 (A9876 in short deck)? (pure function)
+    bool isWheelAceHigh() const {
+        int w=wheelTop();
+        return cards[0].rank==12 && cards[1].rank==w && cards[2].rank==w-1 && cards[3].rank==w-2 && cards[4].rank==w-3;
+    }
+
+    ///\brief sort the cards
+    ///\post The cards are sorted descending: \f$ (\forall {1 \leq i \leq 4} , cards_{i-1} \geq cards_i \wedge cards \neq A5432) \vee cards=5432A \f$
+    ///\code
+    ///context PokerHand::sort(): void
+    ///    post sorted: cardsAreSorted()=TRUE
+    ///\endcode
+    void sort() {
+        //sort descending
+        for (std::vector<PlayCard>::iterator It1=cards.begin(); It1!=cards.end(); It1++)
+            for (std::vector<PlayCard>::iterator It2=It1; It2!=cards.end(); It2++)
+                if (It2->rank > It1->rank) { //unsorted
+                    int tmpr=It2->rank;
+                    It2->rank=It1->rank;
+                    It1->rank=tmpr;
+
+                    int tmps=It2->suit;
+                    It2->suit=It1->suit;
+                    It1->suit=tmps;
+                }
+
+        //transform A5432 in 5432A
+        if (isWheelAceHigh()) {
+            cards.push_back(PlayCard(cards[0].rank,cards[0].suit));
+            cards.erase(cards.begin());
+        }
+
+        contract(cardsAreSorted());//postcondition holds
+    }
+
+    ///\brief check if the signature oh the Hand is correct (pure function)
+    ///\post \f$ result=TRUE \Leftrightarrow \f$
+    ///\post the frequencies hold the number of cards of the different ranks:
+    ///\post \f$ \forall {0 \leq i < sigSize()}, sigFreq(i)=cards.count(rank=sigRank(i)) \wedge \sum_i sigFreq(i)=cards.size() \wedge \f$
+    ///\post the frequencies are ordered descending:
+    ///\post \f$ \forall {1 \leq i < sigSize()} , sigFreq(i-1) \geq sigFreq(i) \wedge \f$
+    ///\post if two freq are the same, the ranks are ordered descending:
+    ///\post \f$ \forall {1 \leq i < sigSize()} (sigFreq(i-1) = sigFreq(i) \Rightarrow sigRank(i-1) > sigRank(i)) \f$
+    ///\post straights only keep their highest card: \f$ isStraight() \Rightarrow signature \bmod 2^{20}=cards_0.rank*2^{16} \f$
+    bool correctSignature() const {
+        bool correct=true;
+        //post1
+        int total=0;
+        for (int i=0; i<sigSize(); i++) {
+            total+=sigFreq(i);
+            if (!isStraight()) {
+                int n=0;
+                for (unsigned int j=0; j<cards.size(); j++)
+                    n+=(cards[j].rank==sigRank(i));
+                correct&=(n==sigFreq(i));
+            }
+        }
+        correct&=(total==(int)cards.size());
+
+        //post2-3
+        for (int i=0; i<sigSize(); i++)
+            for (int j=i+1; j<sigSize(); j++) {
+                correct&=(sigFreq(i)>=sigFreq(j));
+                if (sigFreq(i)==sigFreq(j) && !isStraight()) correct&=(sigRank(i)>sigRank(j));
+            }
+
+        //post4
+        if (isStraight())
+            correct&=((signature&0xFFFFF)==((uint64_t)cards[0].rank<<16));
+
+        return correct;
+    }
+
+    ///\brief calculates the signature
+    ///
+    ///frequencies and ranks are packed in descending nibbles: the frequencies in bits 20-39, the ranks in bits 0-19.
+    ///Straights keep only their highest card (the 5 in 5432A), so that inside a category the hands compare as their signatures.
+    ///\post correctSignature()=TRUE
+    ///\code
+    ///context PokerHand::sort(): void
+    ///    post sorted: correctSignature()=TRUE
+    ///\endcode
+    void calcSignature() {
+        //compile frequencies
+        int freq[13]={0,0,0,0,0,0,0,0,0,0,0,0,0};
+        for (unsigned int i=0; i<cards.size(); i++)
+            freq[cards[i].rank]++;
+
+        //frequencies descending, for equal freq descending ranks
+        uint64_t f=0, r=0;
+        int n=0;
+        for (int k=4; k>=1; k--)
+            for (int rank=12; rank>=0; rank--)
+                if (freq[rank]==k) {
+                    f|=(uint64_t)k<<(16-4*n);
+                    r|=(uint64_t)rank<<(16-4*n);
+                    n++;
+                }
+        //straights: the highest card decides
+        if (isStraight())
+            r=(uint64_t)cards[0].rank<<16;
+        signature=(f<<20)|r;
+
+        contract(correctSignature());//check postconditions
+    }
+
+    ///\brief The hand is a Straight Flush? (pure function)
+    ///\pre correct Signature
+    ///\code
+    ///context PokerHand::isStraightFlush(): bool
+    ///    pre signature: correctSignature()=TRUE
+    ///\endcode
+    ///\post is Straight and is Flush
+    ///\code
+    ///context PokerHand::isStraightFlush(): bool
+    ///    post straightflush: result=isStraight() AND isFlush()
+    ///\endcode
+    bool isStraightFlush() const {
+        contract(correctSignature());//check preconditions
+
+        return (isStraight() && isFlush());
+    };
+
+    ///\brief The hand is Four of a Kind? (pure function)
+    ///\pre correct Signature
+    ///\code
+    ///context PokerHand::isFourOfAKind(): bool
+    ///    pre signature: correctSignature()=TRUE
+    ///\endcode
+    ///\post frequencies=[4,1]
+    ///\code
+    ///context PokerHand::isFourOfAKind(): bool
+    ///    post isfourofakind: result=sigFreq(0)==4 AND sigFreq(1)==1 and sigSize()=2
+    ///\endcode
+    bool isFourOfAKind() const {
+        contract(correctSignature());//check preconditions
+
+        if (sigSize()==2 && sigFreq(0)==4 && sigFreq(1)==1)
+            return true;
+        return false;
+    };
+
+    ///\brief The hand is Full House? (pure function)
+    ///\pre correct Signature
+    ///\code
+    ///context pokerHand::isFullHouse(): bool
+    ///    pre signature: correctSignature()=TRUE
+    ///\endcode
+    ///\post frequencies=[3,2]
+    ///\code
+    ///context pokerHand::isFullHouse(): bool
+    ///    post isfullhouse: result=sigFreq(0)==3 AND sigFreq(1)==2 and sigSize()=2
+    ///\endcode
+    bool isFullHouse() const {
+        contract(correctSignature());//check preconditions
+
+        if (sigSize()==2 && sigFreq(0)==3 && sigFreq(1)==2)
+            return true;
+        return false;
+    };
+
+    ///\brief The hand is Flush (pure function)
+    ///\post same suit: \f$ result=TRUE \Leftrightarrow \forall {1 \leq i \leq cards.size()} , cards_{i}.suit = cards_0.suit \f$
+    bool isFlush() const {
+        bool result=true;
+        for (unsigned int i=0; i<cards.size(); i++)
+            result&=(cards[i].suit==cards[0].suit);
+
+        return result;
+    };
+
+    ///\brief The hand is Straight (pure function)
+    ///\pre sorted cards
+    ///\code
+    ///context pokerHand::isStraight(): bool
+    ///    pre isstraight: cardsAreSorted()
+    ///\endcode
+    ///\post isstraight: \f$ result=TRUE \Leftrightarrow \f$
+    ///\post \f$ \forall {1 \leq i \leq cards.size()} , cards_{i}.suit+1 = cards_{i-1}.suit \vee cards=5432A \f$
+    bool isStraight() const {
+        contract(cardsAreSorted());//check preconditions
+
+        bool result=true;
+        for (unsigned int i=1;i<cards.size();i++)
+            result&=(cards[i].rank+1==cards[i-1].rank);
+
+        //special case (low A)
+        if (isWheel())
+            result=true;
+
+        return result;
+    };
+
+    ///\brief The hand is Three of A Kind? (pure function)
+    ///\pre correct Signature
+    ///\code
+    ///context pokerHand::isThreeOfAKind(): bool
+    ///    pre signature: correctSignature()=TRUE
+    ///\endcode
+    ///\post frequencies=[3,1,1]
+    ///\code
+    ///context pokerHand::isThreeOfAKind(): bool
+    ///    post isthreeofakind: result=sigFreq(0)==3 AND sigFreq(1)==1 AND sigFreq(2)==1 AND sigSize()=3
+    ///\endcode
+    bool isThreeOfAKind() const {
+        contract(correctSignature());//check preconditions
+
+        if (sigSize()==3 && sigFreq(0)==3 && sigFreq(1)==1 && sigFreq(2)==1)
+            return true;
+        return false;
+    };
+
+    ///\brief The hand is Two Pair? (pure function)
+    ///\pre correct Signature
+    ///\code
+    ///context pokerHand::isTwoPair(): bool
+    ///    pre signature: correctSignature()=TRUE
+    ///\endcode
+    ///\post frequencies=[2,2,1]
+    ///\code
+    ///context pokerHand::isTwoPair(): bool
+    ///    post istwopair: result=sigFreq(0)==2 AND sigFreq(1)==2 AND sigFreq(2)==1 AND sigSize()=3
+    ///\endcode
+    bool isTwoPair() const {
+        contract(correctSignature());//check preconditions
+
+        if (sigSize()==3 && sigFreq(0)==2 && sigFreq(1)==2 && sigFreq(2)==1)
+            return true;
+        return false;
+    };
+
+    ///\brief The hand is One Pair? (pure function)
+    ///\pre correct Signature
+    ///\code
+    ///context pokerHand::isOnePair(): bool
+    ///    pre signature: correctSignature()=TRUE
+    ///\endcode
+    ///\post frequencies=[2,1,1,1]
+    ///\code
+    ///context pokerHand::isOnePair(): bool
+    ///    post isonepair: result=sigFreq(0)==2 AND sigFreq(1)==1 AND sigFreq(2)==1 AND sigFreq(3)==1 AND sigSize()=4
+    ///\endcode
+    bool isOnePair() const {
+        contract(correctSignature());//check preconditions
+
+        if (sigSize()==4 && sigFreq(0)==2 && sigFreq(1)==1 && sigFreq(2)==1 && sigFreq(3)==1)
+            return true;
+        return false;
+    };
+
+    ///\brief Best hand inside the same category (pure function)
+    ///\pre correct Signature
+    ///\code
+    ///context pokerHand::betterCards(): bool
+    ///    pre signature: correctSignature()=TRUE
+    ///\endcode
+    ///\post Best straight: \f$ (category=8 \vee category=4) \Rightarrow \f$
+    ///\post \f$ (cards[0].rank = other.cards[0] \Rightarrow result=0) \vee \f$
+    ///\post \f$ (cards[0].rank > other.cards[0] \Rightarrow result=1) \vee \f$
+    ///\post \f$ (cards[0].rank < other.cards[0] \Rightarrow result=2) \f$
+    ///\post Best non straight: \f$ (category \neq 8 \wedge category \neq 4) \Rightarrow \f$
+    ///\post \f$ imin=min(i) \mid sigRank(i) \neq other.sigRank(i) \f$
+    ///\post \f$ \neg \exists imin \Rightarrow result=0 \f$
+    ///\post \f$ sigRank(imin) > other.sigRank(imin) \Rightarrow result=1 \f$
+    ///\post \f$ sigRank(imin) < other.sigRank(imin) \Rightarrow result=2 \f$
+    ///\post the first different rank decides all: the signatures are compared as integers
+    int betterCards(const PokerHand& other) const {
+        contract(correctSignature());//check preconditions
+        contract(category==other.category);
+
+        if (signature==other.signature) return 0;
+        else if (signature>other.signature) return 1;
+        else return 2;
+    }
+
+public:
+    ///the cards in the hand
+    std::vector<PlayCard> cards;
+
+    ///the "signature" of the hand: rank frequencies in bits 20-39 and ranks in bits 0-19, in descending nibbles
+    uint64_t signature;
+
+    ///the category of the hand
+    int category;
+
+    ///the rules the hand is played with
+    Ruleset rules;
+
+    ///\brief Frequency of the i-th rank of the signature, 0 past the last one (pure function)
+    int sigFreq(int i) const {
+        return (int)(signature>>(36-4*i))&0xF;
+    }
+
+    ///\brief i-th rank of the signature (pure function)
+    int sigRank(int i) const {
+        return (int)(signature>>(16-4*i))&0xF;
+    }
+
+    ///\brief Number of different ranks in the signature (pure function)
+    int sigSize() const {
+        int n=0;
+        while (n<5 && sigFreq(n)>0) n++;
+        return n;
+    }
+
+    ///\brief Key ordering all the hands as wins() does: the category, in the order of the rules, above the signature (pure function)
+    uint64_t strength() const {
+        return ((uint64_t)categoryOrder(category,rules)<<40)|signature;
+    }
+
+    ///\brief Inizialize the Hand with parameters and finds out it's category
+    ///
+    ///makes the Class invariant hold
+    ///@param[in] r1 r2 r3 r4 r5 : card ranks \n
+    ///@param[in] s1 s2 s3 s4 s5 : card suits \n
+    ///@param[in] rules : standard or short deck \n
+    ///\pre \f$ \forall i, 0 \leq r_i \leq 12 \wedge 0 \leq s_i \leq 3 \f$, short deck ranks are 6 or more (\f$ r_i \geq 4 \f$)
+    ///\code
+    ///context PlayCard::PlayCard(int r, int s): void
+    ///    pre mainConstr: 0<=rank<=12 && 0<=suit<=3
+    ///\endcode
+    PokerHand(int r1, int s1, int r2, int s2, int r3, int s3, int r4, int s4, int r5, int s5, Ruleset rules=StandardDeck) : rules(rules) {
+        SampledCheck check;
+        cards.push_back(PlayCard(r1,s1));
+        cards.push_back(PlayCard(r2,s2));
+        cards.push_back(PlayCard(r3,s3));
+        cards.push_back(PlayCard(r4,s4));
+        cards.push_back(PlayCard(r5,s5));
+        check.hand(cardBits());
+        //sort the cards
+        sort();
+        //calculating the signature
+        calcSignature();
+        //find the right category
+        if (isStraightFlush()) category=8;
+        else if (isFourOfAKind()) category=7;
+        else if (isFullHouse()) category=6;
+        else if (isFlush()) category=5;
+        else if (isStraight()) category=4;
+        else if (isThreeOfAKind()) category=3;
+        else if (isTwoPair()) category=2;
+        else if (isOnePair()) category=1;
+        else category=0;
+        ClassInv();//Invariant holds
+    }
+
+    ///\brief returns the hand category (pure function)
+    ///\post result=category
+    int getCategory() const {
+        ClassInv();//Invariant holds
+        return category;
+        ClassInv();//Invariant holds
+    }
+
+    ///\brief Print a hand's cards values and the category (pure function)
+    void print() const {
+        ClassInv();//Invariant holds
+
+        char* c[9];
+        c[0]="HighCards";
+        c[1]="OnePair";
+        c[2]="TwoPair";
+        c[3]="ThreeOfAKind";
+        c[4]="Straight";
+        c[5]="Flush";
+        c[6]="FullHouse";
+        c[7]="FourOfAKind";
+        c[8]="StraightFlush";
+
+        for (unsigned int i=0; i<cards.size(); i++)
+            cards[i].print();
+        std::cout<<": "<<c[category]<<"\n";
+
+        ClassInv();//Invariant holds
+    }
+
+    ///\brief Returns TRUE if the current hand wins over the parameter one (pure function)
+    ///\pre no duplicates in 2 hands: \f$ \forall i,j | 0 < i,j < cards.size(), cards[i] \neq other.cards[j] \f$
+    ///\pre same rules: \f$ rules=other.rules \f$
+    ///\post the categories are compared in the order of the rules (categoryOrder()):
+    ///\post \f$ category > other.category \Rightarrow result=1 \f$
+    ///\post \f$ category < other.category \Rightarrow result=2 \f$
+    ///\post \f$ category = other.category \Rightarrow result=batterCards(other) \f$
+    int wins(const PokerHand& other) const {
+        SampledCheck check;
+        check.hand(cardBits()|other.cardBits());
+        ClassInv();//Invariant holds
+        //no duplicated cards in the 2 hands
+        for (unsigned int i=0; i<cards.size(); i++)
+            for (unsigned int j=0; j<other.cards.size(); j++)
+                contract(!cards[i].equals(other.cards[j]));
+        contract(rules==other.rules);
+
+        int order=categoryOrder(category,rules), otherOrder=categoryOrder(other.category,rules);
+        int result;
+        if (order>otherOrder) result=1;
+        else if (order==otherOrder)
+            result=betterCards(other);
+        else result=2;
+
+        ClassInv();//Invariant holds
+        return result;
+    }
+};
+
+///\brief A set of playcards packed in a 64 bit word
+///
+///Every suit owns 16 bits, the card (rank, suit) is stored at bit \f$ suit*16+rank \f$.\n
+///Cards are also packed in a single int as \f$ rank*4+suit \f$ (see packCard()).
+typedef uint64_t CardMask;
+
+///\brief Packs a card in a single int (pure function)
+///\pre \f$ 0 \leq r \leq 12 \wedge 0 \leq s \leq 3 \f$
+///\post \f$ result=r*4+s \f$
+inline int packCard(int r, int s) {
+    assert(r>=0 && r<=12);//check preconditions
+    assert(s>=0 && s<=3);
+    return r*4+s;
+}
+
+///\brief Rank of a packed card (pure function)
+inline int cardRank(int c) {
+    return c>>2;
+}
+
+///\brief Suit of a packed card (pure function)
+inline int cardSuit(int c) {
+    return c&3;
+}
+
+///\brief The mask holding only the packed card c (pure function)
+///\pre \f$ 0 \leq c \leq 51 \f$
+inline CardMask cardBit(int c) {
+    assert(c>=0 && c<=51);//check preconditions
+    return (CardMask)1<<((c&3)*16+(c>>2));
+}
+
+///\brief Number of cards in a mask (pure function)
+inline int countCards(CardMask m) {
+    return __builtin_popcountll(m);
+}
+
+///\brief The 13 bit rank mask of suit s (pure function)
+inline int suitRanks(CardMask m, int s) {
+    return (int)(m>>(s*16))&0x1FFF;
+}
+
+///\brief Category (0..8, as in PokerHand::category, 9 for the five of a kind of evalWild()) of a strength key (pure function)
+inline int keyCategory(int key) {
+    return key>>20;
+}
+
+///\brief Compares two strength keys with the result codes of PokerHand::wins() (pure function)
+///\post \f$ key > other \Rightarrow result=1 \f$
+///\post \f$ key < other \Rightarrow result=2 \f$
+///\post \f$ key = other \Rightarrow result=0 \f$
+inline int showdown(int key, int other) {
+    if (key>other) return 1;
+    else if (key<other) return 2;
+    return 0;
+}
+
+///\brief Highest rank in a non empty rank mask (pure function)
+inline int topRank(int m) {
+    assert(m!=0);//check preconditions
+    return 31-__builtin_clz(m);
+}
+
+///\brief The n highest ranks of a rank mask packed in descending nibbles (pure function)
+///\pre the mask holds at least n ranks
+inline int topRanks(int m, int n) {
+    assert(__builtin_popcount(m)>=n);//check preconditions
+
+    int result=0;
+    for (int i=0; i<n; i++) {
+        int r=topRank(m);
+        result=(result<<4)|r;
+        m&=~(1<<r);
+    }
+    return result;
+}
+
+///\brief Highest rank of the best straight in a rank mask, -1 if there is none (pure function)
+///
+///The Ace is also used as the low card of 5432A, whose highest rank is the 5 (3)
+inline int straightTop(int m) {
+    int ext=(m<<1)|((m>>12)&1);//bit 0 holds the low Ace
+    int s=ext&(ext>>1)&(ext>>2)&(ext>>3)&(ext>>4);
+    if (s==0) return -1;
+    return topRank(s)+3;
+}
+
+///\brief Strength key from the rank masks of a hand (pure function)
+///
+///any, two, three and four hold the ranks appearing at least once, twice, three and four times,
+///flush the ranks of a suit holding five cards or more (0 if there is none). See evalMask().
+inline int evalRanks(int any, int two, int three, int four, int flush) {
+    int result;
+    int t=three ? topRank(three) : 0;
+    if (flush && straightTop(flush)>=0)
+        result=(8<<20)|(straightTop(flush)<<16);
+    else if (four) {
+        int q=topRank(four);
+        result=(7<<20)|(q<<16)|(topRank(any&~(1<<q))<<12);
+    } else if (three && (two&~(1<<t)))
+        result=(6<<20)|(t<<16)|(topRank(two&~(1<<t))<<12);
+    else if (flush)
+        result=(5<<20)|topRanks(flush,5);
+    else if (straightTop(any)>=0)
+        result=(4<<20)|(straightTop(any)<<16);
+    else if (three)
+        result=(3<<20)|(t<<16)|(topRanks(any&~(1<<t),2)<<8);
+    else if (two) {
+        int p1=topRank(two);
+        int rest=two&~(1<<p1);
+        if (rest) {
+            int p2=topRank(rest);
+            result=(2<<20)|(p1<<16)|(p2<<12)|(topRank(any&~(1<<p1)&~(1<<p2))<<8);
+        } else
+            result=(1<<20)|(p1<<16)|(topRanks(any&~(1<<p1),3)<<4);
+    } else
+        result=topRanks(any,5);
+
+    assert(keyCategory(result)>=0 && keyCategory(result)<=8);//check postconditions
+    return result;
+}
+
+///\brief Ranks of the suit holding five cards or more, 0 if there is none (pure function)
+///
+///The four suits are counted at once, each in its 16 bits of a word (no popcount instruction is needed).
+///\pre at most one suit holds five cards or more
+inline int flushRanks(int s0, int s1, int s2, int s3) {
+    uint64_t m=(uint64_t)s0|((uint64_t)s1<<16)|((uint64_t)s2<<32)|((uint64_t)s3<<48);
+    uint64_t c=m-((m>>1)&0x5555555555555555UL);
+    c=(c&0x3333333333333333UL)+((c>>2)&0x3333333333333333UL);
+    c=(c+(c>>4))&0x0F0F0F0F0F0F0F0FUL;
+    c=(c+(c>>8))&0x00FF00FF00FF00FFUL;
+    //count+11 reaches bit 4 from five cards
+    uint64_t five=(c+0x000B000B000B000BUL)&0x0010001000100010UL;
+    if (!five) return 0;
+    return (int)(m>>(__builtin_ctzll(five)&~15))&0x1FFF;
+}
+
+///\brief evalMask() without the size check, for callers that know the size at compile time (pure function)
+inline int evalCards(CardMask m) {
+    int s0=suitRanks(m,0), s1=suitRanks(m,1), s2=suitRanks(m,2), s3=suitRanks(m,3);
+    int two=(s0&s1)|(s2&s3)|((s0|s1)&(s2|s3));//ranks held at least twice
+    int three=(s0&s1&(s2|s3))|(s2&s3&(s0|s1));//ranks held at least three times
+    return evalRanks(s0|s1|s2|s3,two,three,s0&s1&s2&s3,flushRanks(s0,s1,s2,s3));
+}
+
+///\brief Key of the best five card subset of m computed by PokerHand, whose full contract is checked on that subset
+///
+///The subsets are compared with PokerHand::strength() without their contracts (they share cards, so wins() does not apply),
+///the best one is built again with contractChecking set: its violations are logged by contractFailed() with the hand.
+///\pre \f$ 5 \leq countCards(m) \leq 7 \f$
+inline int referenceKey(CardMask m) {
+    bool nested=contractChecking;
+    contractHand=m;
+
+    contractChecking=false;
+    int cards[7], n=0;
+    for (int c=0; c<52; c++)
+        if (m&cardBit(c)) cards[n++]=c;
+    uint64_t best=0;
+    int bestCards[5]={0,0,0,0,0};
+    for (int a=0; a<n; a++)
+        for (int b=a+1; b<n; b++)
+            for (int c=b+1; c<n; c++)
+                for (int d=c+1; d<n; d++)
+                    for (int e=d+1; e<n; e++) {
+                        int k[5]={cards[a],cards[b],cards[c],cards[d],cards[e]};
+                        PokerHand h(cardRank(k[0]),cardSuit(k[0]),cardRank(k[1]),cardSuit(k[1]),cardRank(k[2]),
+                            cardSuit(k[2]),cardRank(k[3]),cardSuit(k[3]),cardRank(k[4]),cardSuit(k[4]));
+                        if (h.strength()>=best) {
+                            best=h.strength();
+                            std::copy(k,k+5,bestCards);
+                        }
+                    }
+    contractChecking=true;
+    const int* k=bestCards;
+    PokerHand hand(cardRank(k[0]),cardSuit(k[0]),cardRank(k[1]),cardSuit(k[1]),cardRank(k[2]),
+        cardSuit(k[2]),cardRank(k[3]),cardSuit(k[3]),cardRank(k[4]),cardSuit(k[4]));
+    int result=hand.getCategory()<<20|(int)(hand.signature&0xFFFFF);
+    contractChecking=nested;
+    return result;
+}
+
+///\brief Sampled check of an evaluation: the key must be referenceKey(m), violations are logged with the hand
+///\pre \f$ 5 \leq countCards(m) \leq 7 \f$
+inline void checkEvaluation(CardMask m, int key) {
+    __atomic_add_fetch(&contractChecks,1,__ATOMIC_RELAXED);
+    int expected=referenceKey(m);
+    if (key!=expected) {
+        char message[64];
+        sprintf(message,"evalMask()=%06X, PokerHand key %06X",key,expected);
+        contractHand=m;
+        contractFailed(message,__LINE__);
+    }
+}
+
+class ShadowVerifier;
+
+///\brief The verifier receiving the sampled evaluations, 0 to check them inline with checkEvaluation()
+extern ShadowVerifier* shadowVerifier;
+
+///\brief Shadow verification: sampled (hand, key) pairs are checked by a background thread
+///
+///Producers (the evaluating threads) only copy the pair into a bounded lock-free queue, dropping it when the queue is full.
+///A single consumer thread, at idle priority where the system allows it, compares the keys with referenceKey() and
+///counts the disagreements. Slots carry sequence numbers: a slot is free for position p when its sequence is p and
+///holds the pair of position p when it is p+1.
+class ShadowVerifier {
+private:
+    class Slot {
+    public:
+        uint64_t sequence;
+        CardMask hand;
+        int key;
+    };
+    std::vector<Slot> slots;
+    uint64_t mask;
+    //producers claim tail, the consumer owns head
+    uint64_t tail;
+    char pad[64];
+    uint64_t head;
+    uint64_t checked, disagreed, lost;
+    bool stopping;
+    pthread_t thread;
+
+    //not copyable
+    ShadowVerifier(const ShadowVerifier&);
+    ShadowVerifier& operator=(const ShadowVerifier&);
+
+    ///\brief Takes the oldest pair, returns false if the queue is empty (consumer only)
+    bool pop(CardMask& hand, int& key) {
+        Slot& s=slots[head&mask];
+        if (__atomic_load_n(&s.sequence,__ATOMIC_ACQUIRE)!=head+1) return false;
+        hand=s.hand;
+        key=s.key;
+        __atomic_store_n(&s.sequence,head+slots.size(),__ATOMIC_RELEASE);
+        head++;
+        return true;
+    }
+
+    static void* run(void* arg) {
+#ifdef SCHED_IDLE
+        sched_param priority;
+        priority.sched_priority=0;
+        pthread_setschedparam(pthread_self(),SCHED_IDLE,&priority);
+#endif
+        ShadowVerifier* v=(ShadowVerifier*)arg;
+        CardMask hand;
+        int key;
+        for (;;) {
+            if (v->pop(hand,key)) {
+                int expected=referenceKey(hand);
+                if (key!=expected) {
+                    __atomic_add_fetch(&v->disagreed,1,__ATOMIC_RELAXED);
+                    char message[64];
+                    sprintf(message,"shadow: key %06X, PokerHand key %06X",key,expected);
+                    contractHand=hand;
+                    contractFailed(message,__LINE__);
+                }
+                __atomic_add_fetch(&v->checked,1,__ATOMIC_RELAXED);
+            } else if (__atomic_load_n(&v->stopping,__ATOMIC_ACQUIRE))
+                return 0;
+            else
+                usleep(1000);
+        }
+    }
+
+public:
+    ///\brief Starts the background thread with a queue of capacity pairs
+    ///\pre capacity is a power of 2
+    explicit ShadowVerifier(size_t capacity=4096) : slots(capacity), mask(capacity-1), tail(0), head(0),
+        checked(0), disagreed(0), lost(0), stopping(false) {
+        assert(capacity>0 && (capacity&(capacity-1))==0);//check preconditions
+        for (size_t i=0; i<capacity; i++)
+            slots[i].sequence=i;
+        pthread_create(&thread,0,run,this);
+    }
+
+    ///\brief Checks the pairs still queued and stops the thread, uninstalls the verifier if it is shadowVerifier
+    ///
+    ///Threads still evaluating must not use the verifier any more: uninstall it first.
+    ~ShadowVerifier() {
+        if (shadowVerifier==this) shadowVerifier=0;
+        __atomic_store_n(&stopping,true,__ATOMIC_RELEASE);
+        pthread_join(thread,0);
+    }
+
+    ///\brief Queues a pair, returns false if the queue was full and the pair was dropped (lock-free, any thread)
+    bool push(CardMask hand, int key) {
+        uint64_t pos=__atomic_load_n(&tail,__ATOMIC_RELAXED);
+        for (;;) {
+            Slot& s=slots[pos&mask];
+            int64_t d=(int64_t)(__atomic_load_n(&s.sequence,__ATOMIC_ACQUIRE)-pos);
+            if (d==0) {
+                if (__atomic_compare_exchange_n(&tail,&pos,pos+1,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) {
+                    s.hand=hand;
+                    s.key=key;
+                    __atomic_store_n(&s.sequence,pos+1,__ATOMIC_RELEASE);
+                    return true;
+                }
+            } else if (d<0) {
+                __atomic_add_fetch(&lost,1,__ATOMIC_RELAXED);
+                return false;
+            } else
+                pos=__atomic_load_n(&tail,__ATOMIC_RELAXED);
+        }
+    }
+
+    ///\brief Pairs checked so far
+    uint64_t verified() const {
+        return __atomic_load_n(&checked,__ATOMIC_RELAXED);
+    }
+
+    ///\brief Pairs whose key was not the one of PokerHand
+    uint64_t disagreements() const {
+        return __atomic_load_n(&disagreed,__ATOMIC_RELAXED);
+    }
+
+    ///\brief Pairs dropped because the queue was full
+    uint64_t dropped() const {
+        return __atomic_load_n(&lost,__ATOMIC_RELAXED);
+    }
+};
+
+///\brief Routes a sampled evaluation to the shadow verifier, or checks it at once without one
+inline void verifySample(CardMask m, int key) {
+    if (shadowVerifier) shadowVerifier->push(m,key);
+    else checkEvaluation(m,key);
+}
+
+///\brief Strength key of the best five card hand inside a set of 5 to 7 cards (pure function)
+///
+///The key holds the category in bits 20-23 and the ranks that decide a match inside the
+///category in descending nibbles, as the low 20 bits of PokerHand::signature.\n
+///This is the fast evaluator: it works on rank masks only and never builds a PokerHand.
+///\pre \f$ 5 \leq countCards(m) \leq 7 \f$
+///\post keys order the hands as PokerHand::wins() does:
+///\code
+///context evalMask(m: CardMask): int
+///    post wins: showdown(evalMask(a), evalMask(b)) = PokerHand(a).wins(PokerHand(b))
+///    post category: keyCategory(result) = PokerHand(m).getCategory()
+///\endcode
+inline int evalMask(CardMask m) {
+    assert(countCards(m)>=5 && countCards(m)<=7);//check preconditions
+    int key=evalCards(m);
+    if (contractSample(1)>=0) verifySample(m,key);
+    return key;
+}
+
+///\brief Evaluates n card sets at once (pure function)
+///\post \f$ \forall {0 \leq i < n}, keys_i=evalMask(hands_i) \f$
+inline void evalBatch(const CardMask* hands, int* keys, int n) {
+    for (int i=0; i<n; i++)
+        keys[i]=evalMask(hands[i]);
+}
+
+///\brief Rank masks of a set of cards that grows one card at a time
+///
+///Enumerations over the next cards (HandPotentialCalculator) build the masks of the known cards once, then only add
+///each completion to a copy of them: a card costs four mask updates instead of a new evaluation of the whole hand.
+class IncrementalHand {
+public:
+    CardMask cards;
+    ///ranks held at least once, twice, three and four times
+    int any, two, three, four;
+
+    ///\brief The masks of the cards of m
+    explicit IncrementalHand(CardMask m=0): cards(0), any(0), two(0), three(0), four(0) {
+        add(m);
+    }
+
+    ///\brief Adds the cards of m
+    ///\pre \f$ (m \& cards)=0 \f$
+    void add(CardMask m) {
+        assert((m&cards)==0);//check preconditions
+        cards|=m;
+        for (; m; m&=m-1) {
+            int r=1<<(__builtin_ctzll(m)&15);
+            four|=three&r;
+            three|=two&r;
+            two|=any&r;
+            any|=r;
+        }
+    }
+
+    ///\brief Strength key of the cards
+    ///\pre \f$ 5 \leq countCards(cards) \leq 7 \f$
+    ///\post \f$ result=evalMask(cards) \f$
+    int key() const {
+        assert(countCards(cards)>=5 && countCards(cards)<=7);//check preconditions
+        int key=evalRanks(any,two,three,four,flushRanks(suitRanks(cards,0),suitRanks(cards,1),suitRanks(cards,2),suitRanks(cards,3)));
+        if (contractSample(1)>=0) verifySample(cards,key);
+        return key;
+    }
+};
+
+///\brief Lookup tables of the short deck evaluator, indexed with the 9 bit rank masks of a 36 card deck (the 6 in bit 0)
+class ShortDeckTables {
+public:
+    ///highest rank (0..12) of the best straight, 9876A included, -1 if there is none
+    int straight[512];
+    ///the 5 highest ranks (0..12) in descending nibbles from bit 16, 0 past the last one
+    int top[512];
+
+    ShortDeckTables() {
+        for (int m=0; m<512; m++) {
+            int ranks=m<<4;
+            int ext=(ranks>>3)|((ranks>>12)&1);//bit 0 holds the low Ace, under the 6
+            int s=ext&(ext>>1)&(ext>>2)&(ext>>3)&(ext>>4);
+            straight[m]=s ? topRank(s)+7 : -1;
+            int n=std::min(__builtin_popcount(m),5);
+            top[m]=n ? topRanks(ranks,n)<<(4*(5-n)) : 0;
+        }
+    }
+
+    ///\brief The n highest ranks of a 13 bit rank mask, in descending nibbles (pure function)
+    ///\pre \f$ 1 \leq n \leq 5 \f$, the mask holds at least n ranks, all of them 6 or more
+    int ranks(int m, int n) const {
+        return top[m>>4]>>(4*(5-n));
+    }
+};
+
+///\brief Short deck strength key from the rank masks of a hand (pure function)
+///
+///As evalRanks(), with the straights of the 36 card deck and the categories in short deck order: the key category
+///is categoryOrder(category,ShortDeck), Flush is 6 and FullHouse is 5.
+inline int evalShortRanks(int any, int two, int three, int four, int flush) {
+    static const ShortDeckTables t;
+    int result;
+    int tr=three ? t.ranks(three,1) : 0;
+    if (flush && t.straight[flush>>4]>=0)
+        result=(8<<20)|(t.straight[flush>>4]<<16);
+    else if (four) {
+        int q=t.ranks(four,1);
+        result=(7<<20)|(q<<16)|(t.ranks(any&~(1<<q),1)<<12);
+    } else if (flush)
+        result=(6<<20)|t.ranks(flush,5);
+    else if (three && (two&~(1<<tr)))
+        result=(5<<20)|(tr<<16)|(t.ranks(two&~(1<<tr),1)<<12);
+    else if (t.straight[any>>4]>=0)
+        result=(4<<20)|(t.straight[any>>4]<<16);
+    else if (three)
+        result=(3<<20)|(tr<<16)|(t.ranks(any&~(1<<tr),2)<<8);
+    else if (two) {
+        int p1=t.ranks(two,1);
+        int rest=two&~(1<<p1);
+        if (rest) {
+            int p2=t.ranks(rest,1);
+            result=(2<<20)|(p1<<16)|(p2<<12)|(t.ranks(any&~(1<<p1)&~(1<<p2),1)<<8);
+        } else
+            result=(1<<20)|(p1<<16)|(t.ranks(any&~(1<<p1),3)<<4);
+    } else
+        result=t.ranks(any,5);
+
+    assert(keyCategory(result)>=0 && keyCategory(result)<=8);//check postconditions
+    return result;
+}
+
+///\brief Short deck strength key of the best five card hand inside a set of 5 to 7 cards (pure function)
+///
+///The key category is categoryOrder(category,ShortDeck), the rest of the key is as in evalMask().
+///\pre \f$ 5 \leq countCards(m) \leq 7 \f$, no card under the 6
+///\post keys order the hands as PokerHand::wins() does with the ShortDeck rules:
+///\code
+///context evalShortDeck(m: CardMask): int
+///    post wins: showdown(evalShortDeck(a), evalShortDeck(b)) = PokerHand(a,ShortDeck).wins(PokerHand(b,ShortDeck))
+///    post category: categoryOrder(keyCategory(result),ShortDeck) = PokerHand(m,ShortDeck).getCategory()
+///\endcode
+inline int evalShortDeck(CardMask m) {
+    assert(countCards(m)>=5 && countCards(m)<=7);//check preconditions
+    assert((m&0x000F000F000F000FUL)==0);
+
+    int s0=suitRanks(m,0), s1=suitRanks(m,1), s2=suitRanks(m,2), s3=suitRanks(m,3);
+    int two=(s0&s1)|(s2&s3)|((s0|s1)&(s2|s3));//ranks held at least twice
+    int three=(s0&s1&(s2|s3))|(s2&s3&(s0|s1));//ranks held at least three times
+    return evalShortRanks(s0|s1|s2|s3,two,three,s0&s1&s2&s3,flushRanks(s0,s1,s2,s3));
+}
+
+///\brief Lookup tables of the wild card evaluator, one per number of wild cards, indexed with 13 bit rank masks
+class WildTables {
+public:
+    ///highest rank of the best straight made with the ranks of the mask and w wild cards, -1 if there is none
+    int16_t straight[6][8192];
+    ///the mask with its w highest missing ranks added
+    int16_t fill[6][8192];
+
+    WildTables() {
+        for (int w=0; w<=5; w++)
+            for (int m=0; m<8192; m++) {
+                straight[w][m]=-1;
+                for (int top=12; top>=3 && straight[w][m]<0; top--) {
+                    int window=(top==3) ? 0x100F : 0x1F<<(top-4);//5432A holds the Ace
+                    if (__builtin_popcount(m&window)+w>=5) straight[w][m]=top;
+                }
+                int f=m;
+                for (int r=12, n=0; r>=0 && n<w; r--)
+                    if (!(f&(1<<r))) {
+                        f|=1<<r;
+                        n++;
+                    }
+                fill[w][m]=f;
+            }
+    }
+};
+
+///\brief Strength key of the best hand made with the natural cards m and w wild cards (jokers, deuces, ...) (pure function)
+///
+///The wild cards never go through substitutions: straights and flushes come from per wild count tables (WildTables),
+///pairs, trips, full houses and quads from giving all the wild cards to the most frequent (then highest) rank.
+///A wild card in a flush plays as the highest rank missing in the suit.
+///Five of a kind is category 9, above the straight flush, keyed with its rank: \f$ 9*2^{20}+rank*2^{16} \f$.
+///\pre \f$ 0 \leq w \leq 5 \wedge 5 \leq countCards(m)+w \leq 7 \f$
+///\post \f$ w=0 \Rightarrow result=evalMask(m) \f$
+inline int evalWild(CardMask m, int w) {
+    static const WildTables t;
+    assert(w>=0 && w<=5);//check preconditions
+    assert(countCards(m)+w>=5 && countCards(m)+w<=7);
+
+    int s[4]={suitRanks(m,0),suitRanks(m,1),suitRanks(m,2),suitRanks(m,3)};
+    int any=s[0]|s[1]|s[2]|s[3];
+    int two=(s[0]&s[1])|(s[2]&s[3])|((s[0]|s[1])&(s[2]|s[3]));
+    int three=(s[0]&s[1]&(s[2]|s[3]))|(s[2]&s[3]&(s[0]|s[1]));
+    int four=s[0]&s[1]&s[2]&s[3];
+
+    //five of a kind: the highest rank reaching five
+    int reach=(w>=5) ? 0x1FFF : (w==4) ? any : (w==3) ? two : (w==2) ? three : (w==1) ? four : 0;
+    if (reach) return (9<<20)|(topRank(reach)<<16);
+
+    int best=0;
+    //straight flushes and flushes
+    for (int i=0; i<4; i++)
+        if (__builtin_popcount(s[i])+w>=5) {
+            if (t.straight[w][s[i]]>=0)
+                best=std::max(best,(8<<20)|(t.straight[w][s[i]]<<16));
+            else
+                best=std::max(best,(5<<20)|topRanks(t.fill[w][s[i]],5));
+        }
+    //straights
+    if (t.straight[w][any]>=0)
+        best=std::max(best,(4<<20)|(t.straight[w][any]<<16));
+    //the wild cards join the most frequent rank
+    if (w) {
+        int most=four ? four : three ? three : two ? two : any;
+        int r=1<<topRank(most);
+        int level=(four ? 4 : three ? 3 : two ? 2 : 1)+w;//at most 4, five of a kind was ruled out
+        two|=r;
+        if (level>=3) three|=r;
+        if (level>=4) four|=r;
+    }
+    best=std::max(best,evalRanks(any,two,three,four,0));
+
+    assert(w>0 || best==evalMask(m));//check postconditions
+    return best;
+}
+
+///\brief Deuces wild: strength key of the best hand where the 2s play as wild cards (pure function)
+///\pre \f$ 5 \leq countCards(m) \leq 7 \f$
+inline int evalDeucesWild(CardMask m) {
+    CardMask deuces=m&0x0001000100010001UL;
+    return evalWild(m&~deuces,countCards(deuces));
+}
+
+///\brief Compile time check of a hand size: only the sizes the evaluator handles are defined
+template<int N> struct HandSize;
+template<> struct HandSize<5> {};
+template<> struct HandSize<6> {};
+template<> struct HandSize<7> {};
+
+///\brief Mask of N packed cards, unrolled at compile time (pure function)
+template<int N>
+struct CardsMask {
+    static CardMask of(const int* cards) {
+        return CardsMask<N-1>::of(cards)|cardBit(cards[N-1]);
+    }
+};
+
+template<>
+struct CardsMask<0> {
+    static CardMask of(const int*) {
+        return 0;
+    }
+};
+
+///\brief Evaluator of a ruleset, chosen at compile time
+template<Ruleset R> struct RulesetEvaluator;
+
+template<>
+struct RulesetEvaluator<StandardDeck> {
+    static int key(CardMask m) {
+        return evalCards(m);
+    }
+};
+
+template<>
+struct RulesetEvaluator<ShortDeck> {
+    static int key(CardMask m) {
+        return evalShortDeck(m);
+    }
+};
+
+///\brief Strength key of N packed cards played with the rules R, the size is checked at compile time (pure function)
+///
+///evaluate<5,StandardDeck>() serves draw, evaluate<6,ShortDeck>() short deck (36 cards) and evaluate<7,StandardDeck>() Hold'em.
+///\pre the cards are different, none under the 6 in short deck
+///\post result=evalMask(mask of the cards) with the standard rules, evalShortDeck(mask of the cards) in short deck
+template<int N, Ruleset R>
+inline int evaluate(const int* cards) {
+    (void)sizeof(HandSize<N>);
+    CardMask m=CardsMask<N>::of(cards);
+    assert(countCards(m)==N);//check preconditions
+    return RulesetEvaluator<R>::key(m);
+}
+
+///\brief evaluate<N,StandardDeck>() (pure function)
+template<int N>
+inline int evaluate(const int* cards) {
+    return evaluate<N,StandardDeck>(cards);
+}
+
+///\brief N packed cards evaluated with evaluate<N,R>()
+template<int N, Ruleset R=StandardDeck>
+class Hand {
+public:
+    ///packed cards (packCard())
+    int cards[N];
+
+    Hand() {
+        (void)sizeof(HandSize<N>);
+    }
+
+    explicit Hand(const int* c) {
+        (void)sizeof(HandSize<N>);
+        std::copy(c,c+N,cards);
+    }
+
+    ///\brief Mask of the cards (pure function)
+    CardMask mask() const {
+        return CardsMask<N>::of(cards);
+    }
+
+    ///\brief Strength key of the hand (pure function)
+    int evaluate() const {
+        return ::evaluate<N,R>(cards);
+    }
+};
+
+///\brief Compile time check of an Omaha layout: 4 to 6 hole cards, 3 to 5 board cards
+template<int H, int B> struct OmahaLayout;
+template<> struct OmahaLayout<4,3> {};
+template<> struct OmahaLayout<4,4> {};
+template<> struct OmahaLayout<4,5> {};
+template<> struct OmahaLayout<5,3> {};
+template<> struct OmahaLayout<5,4> {};
+template<> struct OmahaLayout<5,5> {};
+template<> struct OmahaLayout<6,3> {};
+template<> struct OmahaLayout<6,4> {};
+template<> struct OmahaLayout<6,5> {};
+
+///\brief Strength key of the best Omaha hand: exactly two of the H hole cards and three of the B board cards (pure function)
+///
+///The \f$ \binom{H}{2} \f$ hole pairs and \f$ \binom{B}{3} \f$ board triples are built first, every loop has a compile time bound.
+///\pre the H+B cards are different
+template<int H, int B>
+int evaluateOmaha(const int* hole, const int* board) {
+    (void)sizeof(OmahaLayout<H,B>);
+    assert(countCards(CardsMask<H>::of(hole)|CardsMask<B>::of(board))==H+B);//check preconditions
+
+    CardMask pairs[H*(H-1)/2], triples[B*(B-1)*(B-2)/6];
+    int p=0, t=0;
+    for (int i=0; i<H; i++)
+        for (int j=i+1; j<H; j++)
+            pairs[p++]=cardBit(hole[i])|cardBit(hole[j]);
+    for (int i=0; i<B; i++)
+        for (int j=i+1; j<B; j++)
+            for (int k=j+1; k<B; k++)
+                triples[t++]=cardBit(board[i])|cardBit(board[j])|cardBit(board[k]);
+
+    int best=0;
+    for (int i=0; i<H*(H-1)/2; i++)
+        for (int j=0; j<B*(B-1)*(B-2)/6; j++)
+            best=std::max(best,evalCards(pairs[i]|triples[j]));
+    return best;
+}
+
+///\brief An Omaha hand: H hole cards and B board cards evaluated with evaluateOmaha()
+template<int H, int B>
+class OmahaHand {
+public:
+    ///packed hole cards
+    int hole[H];
+    ///packed board cards
+    int board[B];
+
+    OmahaHand() {
+        (void)sizeof(OmahaLayout<H,B>);
+    }
+
+    OmahaHand(const int* h, const int* b) {
+        (void)sizeof(OmahaLayout<H,B>);
+        std::copy(h,h+H,hole);
+        std::copy(b,b+B,board);
+    }
+
+    ///\brief Strength key of the hand (pure function)
+    int evaluate() const {
+        return evaluateOmaha<H,B>(hole,board);
+    }
+};
+
+///\brief A read only view of characters: the text is neither copied nor owned
+class TextView {
+public:
+    const char* data;
+    size_t size;
+
+    TextView(const char* data, size_t size) : data(data), size(size) {
+    }
+
+    ///\brief View of a null terminated string
+    explicit TextView(const char* text) : data(text), size(strlen(text)) {
+    }
+};
+
+///\brief Where and why a text could not be parsed
+class ParseError {
+public:
+    ///offset of the offending character in the text, -1 if there is no error
+    long position;
+    ///what is wrong, 0 if there is no error
+    const char* message;
+
+    ParseError() : position(-1), message(0) {
+    }
+};
+
+///\brief Decodes playcards from text without allocating: every character is looked up in a 256 entry table
+///
+///A card is a rank (2 3 4 5 6 7 8 9 X/T J Q K A) followed by a suit (S C D H), letters in either case.
+///Cards are separated by blanks (space, tab, new line, comma).
+class CardParser {
+private:
+    ///rank and suit of every character, -1 if it is neither, 1 in blanks for the separators
+    int8_t ranks[256], suits[256], blanks[256];
+
+public:
+    CardParser() {
+        std::fill(ranks,ranks+256,-1);
+        std::fill(suits,suits+256,-1);
+        std::fill(blanks,blanks+256,0);
+        const char* r="23456789XJQKA";
+        for (int i=0; i<13; i++) {
+            ranks[(unsigned char)r[i]]=i;
+            ranks[(unsigned char)tolower(r[i])]=i;
+        }
+        ranks['T']=ranks['t']=8;
+        const char* s="SCDH";
+        for (int i=0; i<4; i++) {
+            suits[(unsigned char)s[i]]=i;
+            suits[(unsigned char)tolower(s[i])]=i;
+        }
+        blanks[' ']=blanks['\t']=blanks['\n']=blanks['\r']=blanks[',']=1;
+    }
+
+    ///\brief Packed card of two characters, -1 if they are not a card (pure function)
+    int card(char rank, char suit) const {
+        int r=ranks[(unsigned char)rank], s=suits[(unsigned char)suit];
+        return (r<0 || s<0) ? -1 : r*4+s;
+    }
+
+    ///\brief Parses the cards of a text
+    ///@param[in] text: the cards, separated by blanks \n
+    ///@param[out] cards: the packed cards (packCard()) \n
+    ///@param[in] max: room in cards \n
+    ///@param[out] error: position and reason of the first error \n
+    ///@return the number of cards, -1 on errors (bad rank or suit, more than max cards, duplicated card)
+    int parse(TextView text, int* cards, int max, ParseError& error) const {
+        int n=0;
+        CardMask seen=0;
+        size_t i=0;
+        while (i<text.size) {
+            if (blanks[(unsigned char)text.data[i]]) {
+                i++;
+                continue;
+            }
+            if (ranks[(unsigned char)text.data[i]]<0) {
+                error.position=i;
+                error.message="bad rank";
+                return -1;
+            }
+            if (i+1>=text.size || suits[(unsigned char)text.data[i+1]]<0) {
+                error.position=i+1;
+                error.message="bad suit";
+                return -1;
+            }
+            if (i+2<text.size && !blanks[(unsigned char)text.data[i+2]]) {
+                error.position=i+2;
+                error.message="missing blank after card";
+                return -1;
+            }
+            int c=card(text.data[i],text.data[i+1]);
+            if (seen&cardBit(c)) {
+                error.position=i;
+                error.message="duplicated card";
+                return -1;
+            }
+            if (n==max) {
+                error.position=i;
+                error.message="too many cards";
+                return -1;
+            }
+            seen|=cardBit(c);
+            cards[n++]=c;
+            i+=2;
+        }
+        return n;
+    }
+};
+
+///\brief A growable array aligned to cache lines
+template<class T>
+class AlignedArray {
+private:
+    T* items;
+    size_t count;
+    size_t capacity;
+
+public:
+    AlignedArray() : items(0), count(0), capacity(0) {
+    }
+
+    AlignedArray(const AlignedArray& other) : items(0), count(0), capacity(0) {
+        *this=other;
+    }
+
+    AlignedArray& operator=(const AlignedArray& other) {
+        if (this!=&other) {
+            resize(other.count);
+            std::copy(other.items,other.items+other.count,items);
+        }
+        return *this;
+    }
+
+    ~AlignedArray() {
+        free(items);
+    }
+
+    ///\brief Makes room for n items
+    void reserve(size_t n) {
+        if (n<=capacity) return;
+        size_t c=std::max(n,2*capacity);
+        void* p=0;
+        if (posix_memalign(&p,64,std::max(c*sizeof(T),(size_t)64))!=0) {
+            std::cerr<<"Out of memory\n";
+            abort();
+        }
+        std::copy(items,items+count,(T*)p);
+        free(items);
+        items=(T*)p;
+        capacity=c;
+    }
+
+    ///\brief Sets the size to n, new items are zero
+    void resize(size_t n) {
+        reserve(n);
+        if (n>count) std::fill(items+count,items+n,T());
+        count=n;
+    }
+
+    ///\brief Adds n items left uninitialized, for writers filling them at once: returns the first one
+    T* grow(size_t n) {
+        reserve(count+n);
+        count+=n;
+        return items+count-n;
+    }
+
+    void push_back(const T& x) {
+        reserve(count+1);
+        items[count++]=x;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    T* data() {
+        return items;
+    }
+
+    const T* data() const {
+        return items;
+    }
+
+    T& operator[](size_t i) {
+        assert(i<count);//check preconditions
+        return items[i];
+    }
+
+    const T& operator[](size_t i) const {
+        assert(i<count);//check preconditions
+        return items[i];
+    }
+};
+
+///\brief Spreads the bits of 7 bit rank masks to nibbles: bit r goes to bit 4r
+class NibbleTable {
+public:
+    uint64_t spread[128];
+
+    NibbleTable() {
+        for (int m=0; m<128; m++) {
+            spread[m]=0;
+            for (int r=0; r<7; r++)
+                spread[m]|=(uint64_t)((m>>r)&1)<<(4*r);
+        }
+    }
+};
+
+///\brief Card mask and rank count nibble of every packed card
+class PackedCardTables {
+public:
+    ///cardBit() of the card
+    CardMask bit[52];
+    ///1 in the nibble of the rank of the card
+    uint64_t rank[52];
+
+    PackedCardTables() {
+        for (int c=0; c<52; c++) {
+            bit[c]=cardBit(c);
+            rank[c]=(uint64_t)1<<(4*cardRank(c));
+        }
+    }
+};
+
+///\brief A 13 bit rank mask with rank r moved to bit 4r, one nibble per rank (pure function)
+inline uint64_t rankNibbles(int ranks) {
+    static const NibbleTable t;
+    return t.spread[ranks&127]|(t.spread[ranks>>7]<<28);
+}
+
+///\brief Many hands of 5 to 7 cards stored as parallel arrays
+///
+///For every hand the batch holds the rank mask of each suit, the number of cards of each rank
+///(13 nibbles, rank r in bits \f$ 4r \ldots 4r+3 \f$) and the ranks of its flush suit (0 without flush).
+///Kernels read the arrays directly: no object is built per hand.
+///\invariant All the arrays have the same size
+///\code
+///context HandBatch
+///    inv sameSize: suits[s].size()=counts.size()=flush.size()
+///\endcode
+///\invariant counts and flush agree with the suits (checked on every hand added)
+class HandBatch {
+private:
+    ///\brief Verify that the Class Invariant holds
+    void ClassInv() const {
+        for (int s=0; s<4; s++)
+            assert(suits[s].size()==counts.size());
+        assert(flush.size()==counts.size());
+    }
+
+    ///\brief Checks the derived arrays of hand i (pure function)
+    bool consistent(size_t i) const {
+        uint64_t c=0;
+        for (int s=0; s<4; s++)
+            for (int r=0; r<13; r++)
+                c+=(uint64_t)((suits[s][i]>>r)&1)<<(4*r);
+        return c==counts[i] && flush[i]==flushRanks(suits[0][i],suits[1][i],suits[2][i],suits[3][i]);
+    }
+
+public:
+    ///rank mask of each suit
+    AlignedArray<uint16_t> suits[4];
+    ///number of cards of every rank, in nibbles
+    AlignedArray<uint64_t> counts;
+    ///ranks of the flush suit, 0 if there is none
+    AlignedArray<uint16_t> flush;
+
+    ///\brief A view on consecutive hands of a batch
+    class Span {
+    public:
+        const HandBatch* batch;
+        size_t first;
+        size_t count;
+
+        Span(const HandBatch* batch, size_t first, size_t count) : batch(batch), first(first), count(count) {
+            assert(first+count<=batch->size());//check preconditions
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        ///\brief The cards of hand i of the view (pure function)
+        CardMask operator[](size_t i) const {
+            return batch->mask(first+i);
+        }
+
+        ///\brief Strength keys of the hands of the view, as evalMask() computes them
+        ///
+        ///A first pass computes the ranks held two, three and four times with bitwise operations on whole arrays,
+        ///a second one decides the categories (evalRanks()).
+        ///\post \f$ \forall {0 \leq i < size()}, keys_i=evalMask((*this)[i]) \f$
+        void evaluate(int* keys) const {
+            const int B=64;
+            uint16_t any[B], two[B], three[B], four[B];
+            for (size_t done=0; done<count; done+=B) {
+                size_t n=std::min((size_t)B,count-done);
+                const uint16_t* s0=batch->suits[0].data()+first+done;
+                const uint16_t* s1=batch->suits[1].data()+first+done;
+                const uint16_t* s2=batch->suits[2].data()+first+done;
+                const uint16_t* s3=batch->suits[3].data()+first+done;
+                for (size_t i=0; i<n; i++) {
+                    any[i]=s0[i]|s1[i]|s2[i]|s3[i];
+                    two[i]=(s0[i]&s1[i])|(s2[i]&s3[i])|((s0[i]|s1[i])&(s2[i]|s3[i]));
+                    three[i]=(s0[i]&s1[i]&(s2[i]|s3[i]))|(s2[i]&s3[i]&(s0[i]|s1[i]));
+                    four[i]=s0[i]&s1[i]&s2[i]&s3[i];
+                }
+                const uint16_t* f=batch->flush.data()+first+done;
+                for (size_t i=0; i<n; i++)
+                    keys[done+i]=evalRanks(any[i],two[i],three[i],four[i],f[i]);
+            }
+            long i=contractSample(count);
+            if (i>=0) verifySample((*this)[i],keys[i]);
+        }
+    };
+
+    ///\brief Iterates on the hands of a batch
+    class const_iterator {
+    public:
+        const HandBatch* batch;
+        size_t i;
+
+        const_iterator(const HandBatch* batch, size_t i) : batch(batch), i(i) {
+        }
+
+        CardMask operator*() const {
+            return batch->mask(i);
+        }
+
+        const_iterator& operator++() {
+            i++;
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return i==other.i;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return i!=other.i;
+        }
+    };
+
+    ///\brief Number of hands (pure function)
+    size_t size() const {
+        return counts.size();
+    }
+
+    ///\brief Makes room for n hands
+    void reserve(size_t n) {
+        for (int s=0; s<4; s++)
+            suits[s].reserve(n);
+        counts.reserve(n);
+        flush.reserve(n);
+    }
+
+    ///\brief Removes all the hands
+    void clear() {
+        for (int s=0; s<4; s++)
+            suits[s].resize(0);
+        counts.resize(0);
+        flush.resize(0);
+    }
+
+    ///\brief Adds a hand
+    ///\pre \f$ 5 \leq countCards(m) \leq 7 \f$
+    ///\post \f$ mask(size()-1)=m \f$
+    void push_back(CardMask m) {
+        ClassInv();//Invariant holds
+        assert(countCards(m)>=5 && countCards(m)<=7);//check preconditions
+
+        uint64_t c=0;
+        for (int s=0; s<4; s++) {
+            int ranks=suitRanks(m,s);
+            suits[s].push_back(ranks);
+            c+=rankNibbles(ranks);
+        }
+        counts.push_back(c);
+        flush.push_back(flushRanks(suitRanks(m,0),suitRanks(m,1),suitRanks(m,2),suitRanks(m,3)));
+
+        //check postconditions
+        assert(mask(size()-1)==m);
+        assert(consistent(size()-1));
+        ClassInv();//Invariant holds
+    }
+
+    ///\brief Adds n hands, the arrays grow once
+    ///\pre \f$ \forall i, 5 \leq countCards(masks_i) \leq 7 \f$
+    ///\post the hands are the last n of the batch, as with push_back()
+    void append(const CardMask* masks, size_t n) {
+        ClassInv();//Invariant holds
+
+        size_t first=size();
+        for (int s=0; s<4; s++)
+            suits[s].resize(first+n);
+        counts.resize(first+n);
+        flush.resize(first+n);
+        uint16_t* s0=suits[0].data()+first;
+        uint16_t* s1=suits[1].data()+first;
+        uint16_t* s2=suits[2].data()+first;
+        uint16_t* s3=suits[3].data()+first;
+        uint64_t* c=counts.data()+first;
+        uint16_t* f=flush.data()+first;
+        for (size_t i=0; i<n; i++) {
+            CardMask m=masks[i];
+            assert(countCards(m)>=5 && countCards(m)<=7);//check preconditions
+            s0[i]=suitRanks(m,0);
+            s1[i]=suitRanks(m,1);
+            s2[i]=suitRanks(m,2);
+            s3[i]=suitRanks(m,3);
+            c[i]=rankNibbles(s0[i])+rankNibbles(s1[i])+rankNibbles(s2[i])+rankNibbles(s3[i]);
+            f[i]=flushRanks(s0[i],s1[i],s2[i],s3[i]);
+        }
+
+        //check postconditions
+        for (size_t i=first; i<size(); i++)
+            assert(mask(i)==masks[i-first] && consistent(i));
+        ClassInv();//Invariant holds
+    }
+
+    ///\brief Adds hands of K packed cards (cards \f$ K*i \ldots K*i+K-1 \f$ are hand i), without building them as masks
+    ///
+    ///The hands come in groups of group hands (the hands of a line) and a group holding a card twice ends the append:
+    ///the arrays are written directly, the card mask and the rank counts of a hand are summed from per card tables.
+    ///\pre \f$ \forall i, cards_i < 52 \f$, n is a multiple of group
+    ///\post the first result hands are added as with push_back(), result is n or the first group holding a card twice
+    template<int K>
+    size_t appendCards(const uint8_t* cards, size_t n, int group=1) {
+        (void)sizeof(HandSize<K>);
+        static const PackedCardTables t;
+        ClassInv();//Invariant holds
+        assert(group>=1 && n%group==0);//check preconditions
+
+        size_t first=size();
+        uint16_t* s0=suits[0].grow(n);
+        uint16_t* s1=suits[1].grow(n);
+        uint16_t* s2=suits[2].grow(n);
+        uint16_t* s3=suits[3].grow(n);
+        uint64_t* c=counts.grow(n);
+        uint16_t* f=flush.grow(n);
+        size_t i=0;
+        for (; i<n; i+=group) {
+            //a card already in the group sets a bit of twice
+            CardMask all=0, twice=0;
+            for (size_t h=i; h<i+group; h++) {
+                const uint8_t* p=cards+K*h;
+                CardMask m=0;
+                uint64_t ranks=0;
+                for (int j=0; j<K; j++) {
+                    assert(p[j]<52);//check preconditions
+                    CardMask b=t.bit[p[j]];
+                    twice|=m&b;
+                    m|=b;
+                    ranks+=t.rank[p[j]];
+                }
+                twice|=all&m;
+                all|=m;
+                s0[h]=suitRanks(m,0);
+                s1[h]=suitRanks(m,1);
+                s2[h]=suitRanks(m,2);
+                s3[h]=suitRanks(m,3);
+                c[h]=ranks;
+                f[h]=flushRanks(s0[h],s1[h],s2[h],s3[h]);
+            }
+            if (twice) break;
+        }
+        for (int s=0; s<4; s++)
+            suits[s].resize(first+i);
+        counts.resize(first+i);
+        flush.resize(first+i);
+
+        //check postconditions
+        for (size_t h=first; h<size(); h++)
+            assert(countCards(mask(h))==K && consistent(h));
+        ClassInv();//Invariant holds
+        return i;
+    }
+
+    ///\brief Adds the cards of a PokerHand
+    void push_back(const PokerHand& hand) {
+        CardMask m=0;
+        for (unsigned int i=0; i<hand.cards.size(); i++)
+            m|=cardBit(packCard(hand.cards[i].rank,hand.cards[i].suit));
+        push_back(m);
+    }
+
+    ///\brief The cards of hand i (pure function)
+    CardMask mask(size_t i) const {
+        CardMask m=0;
+        for (int s=0; s<4; s++)
+            m|=(CardMask)suits[s][i]<<(16*s);
+        return m;
+    }
+
+    ///\brief Number of cards of rank r in hand i (pure function)
+    int rankCount(size_t i, int r) const {
+        return (int)(counts[i]>>(4*r))&0xF;
+    }
+
+    ///\brief Hand i as a PokerHand, for debugging
+    ///\pre hand i holds five cards
+    PokerHand toPokerHand(size_t i) const {
+        CardMask m=mask(i);
+        assert(countCards(m)==5);//check preconditions
+
+        int p[10], k=0;
+        for (int c=0; c<52; c++)
+            if (m&cardBit(c)) {
+                p[k++]=cardRank(c);
+                p[k++]=cardSuit(c);
+            }
+        return PokerHand(p[0],p[1],p[2],p[3],p[4],p[5],p[6],p[7],p[8],p[9]);
+    }
+
+    ///\brief View on count hands starting at first
+    Span span(size_t first, size_t count) const {
+        return Span(this,first,count);
+    }
+
+    ///\brief View on all the hands
+    Span all() const {
+        return Span(this,0,size());
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this,0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this,size());
+    }
+};
+
+///\brief Tables of the vectorized card decoders: the values of the characters by high and low nibble
+///
+///The 0x3_ characters hold the digit ranks, 0x4_ and 0x6_ (either case of A..O) and 0x5_ and 0x7_ (P..Z) the letters.
+///Entries that are no rank or suit hold 0xFF.
+class TokenTables {
+public:
+    uint8_t digits[16], ranksLow[16], ranksHigh[16], suitsLow[16], suitsHigh[16];
+
+    TokenTables() {
+        std::fill(digits,digits+16,0xFF);
+        std::fill(ranksLow,ranksLow+16,0xFF);
+        std::fill(ranksHigh,ranksHigh+16,0xFF);
+        std::fill(suitsLow,suitsLow+16,0xFF);
+        std::fill(suitsHigh,suitsHigh+16,0xFF);
+        for (int d=2; d<=9; d++)
+            digits[d]=d-2;
+        ranksLow['A'&15]=12;
+        ranksLow['J'&15]=9;
+        ranksLow['K'&15]=11;
+        ranksHigh['Q'&15]=10;
+        ranksHigh['T'&15]=8;
+        ranksHigh['X'&15]=8;
+        suitsLow['C'&15]=1;
+        suitsLow['D'&15]=2;
+        suitsLow['H'&15]=3;
+        suitsHigh['S'&15]=0;
+    }
+};
+
+///\brief Decodes tokens of three characters (rank, suit, separator) into packed cards and separators, one at a time
+///@param[out] cards: the packed card of every token, 0xFF if it is not a card \n
+///@param[out] seps: the separator of every token \n
+///\pre the text holds 3*n characters
+inline void decodeTokens(const char* text, size_t n, uint8_t* cards, char* seps) {
+    static const CardParser parser;
+    for (size_t i=0; i<n; i++) {
+        int c=parser.card(text[3*i],text[3*i+1]);
+        cards[i]=(c<0) ? 0xFF : c;
+        seps[i]=text[3*i+2];
+    }
+}
+
+#ifdef POKER_X86
+///\brief SSSE3 kernel of decodeTokensSimd(): five tokens from 16 characters (the last one is not used)
+///
+///The ranks are gathered in lanes 0-4 and the suits in lanes 8-12. Every character is looked up by low nibble (pshufb)
+///in the rank and suit tables of its high nibble, characters of any other high nibble become 0xFF, then the rank lanes
+///take the rank values and the suit lanes the suit values.
+__attribute__((target("ssse3")))
+static inline __m128i decodeFive(__m128i v, const TokenTables& t, __m128i& seps) {
+    const __m128i ones=_mm_set1_epi8(-1);
+    const __m128i nibble=_mm_set1_epi8(15);
+    const __m128i two=_mm_set1_epi8(2);
+    const __m128i rankLanes=_mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,0,0,0,0,0,0,0,0);
+    seps=_mm_shuffle_epi8(v,_mm_setr_epi8(2,5,8,11,14,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1));
+    __m128i g=_mm_shuffle_epi8(v,_mm_setr_epi8(0,3,6,9,12,-1,-1,-1,1,4,7,10,13,-1,-1,-1));
+    __m128i lo=_mm_and_si128(g,nibble);
+    __m128i hi=_mm_and_si128(_mm_srli_epi16(g,4),nibble);
+    __m128i isDigit=_mm_cmpeq_epi8(hi,_mm_set1_epi8(3));
+    __m128i isLow=_mm_cmpeq_epi8(_mm_or_si128(hi,two),_mm_set1_epi8(6));
+    __m128i isHigh=_mm_cmpeq_epi8(_mm_or_si128(hi,two),_mm_set1_epi8(7));
+    __m128i ranks=_mm_or_si128(_mm_and_si128(isDigit,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)t.digits),lo)),
+        _mm_or_si128(_mm_and_si128(isLow,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)t.ranksLow),lo)),
+        _mm_and_si128(isHigh,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)t.ranksHigh),lo))));
+    //digits are no suit
+    __m128i suits=_mm_or_si128(_mm_and_si128(isLow,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)t.suitsLow),lo)),
+        _mm_or_si128(_mm_and_si128(isHigh,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)t.suitsHigh),lo)),isDigit));
+    __m128i values=_mm_or_si128(_mm_and_si128(rankLanes,ranks),_mm_andnot_si128(rankLanes,suits));
+    values=_mm_or_si128(values,_mm_andnot_si128(_mm_or_si128(isDigit,_mm_or_si128(isLow,isHigh)),ones));
+    //rank*4+suit, 0xFF if either is unknown
+    __m128i suit=_mm_srli_si128(values,8);
+    __m128i bad=_mm_or_si128(_mm_cmpeq_epi8(values,ones),_mm_cmpeq_epi8(suit,ones));
+    __m128i packed=_mm_add_epi8(_mm_add_epi8(values,values),_mm_add_epi8(values,values));
+    return _mm_or_si128(_mm_add_epi8(packed,suit),bad);
+}
+
+///\brief decodeTokens() with SSSE3, five tokens per step
+__attribute__((target("ssse3")))
+inline size_t decodeTokensSsse3(const char* text, size_t n, uint8_t* cards, char* seps) {
+    static const TokenTables t;
+    size_t i=0;
+    //16 characters are read for 15
+    for (; i+6<=n; i+=5) {
+        __m128i s;
+        __m128i c=decodeFive(_mm_loadu_si128((const __m128i*)(text+3*i)),t,s);
+        _mm_storel_epi64((__m128i*)(cards+i),c);
+        _mm_storel_epi64((__m128i*)(seps+i),s);
+    }
+    return i;
+}
+
+///\brief Same table in both 128 bit lanes
+__attribute__((target("avx2")))
+static inline __m256i broadcastTable(const uint8_t* table) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table));
+}
+
+///\brief Tables of decodeTen(), the TokenTables in both 128 bit lanes
+class TokenTablesAvx2 {
+public:
+    __m256i digits, ranksLow, ranksHigh, suitsLow, suitsHigh;
+};
+
+///\brief AVX2 kernel of decodeTokensAvx2(): ten tokens from 31 characters, each 128 bit lane decodes five as decodeFive()
+///
+///The second lane starts 15 characters after the first one. The cards and separators of the first lane are in
+///bytes 0-4 and the ones of the second lane in bytes 16-20.
+__attribute__((target("avx2")))
+static inline __m256i decodeTen(const char* text, const TokenTablesAvx2& t, __m256i& seps) {
+    const __m256i gather=_mm256_setr_epi8(0,3,6,9,12,-1,-1,-1,1,4,7,10,13,-1,-1,-1,0,3,6,9,12,-1,-1,-1,1,4,7,10,13,-1,-1,-1);
+    const __m256i gatherSeps=_mm256_setr_epi8(2,5,8,11,14,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,2,5,8,11,14,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+    const __m256i nibble=_mm256_set1_epi8(15);
+    const __m256i two=_mm256_set1_epi8(2);
+    const __m256i ones=_mm256_set1_epi8(-1);
+    const __m256i rankLanes=_mm256_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,0,0,0,0,0,0,0,0,-1,-1,-1,-1,-1,-1,-1,-1,0,0,0,0,0,0,0,0);
+    __m256i v=_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)text)),
+        _mm_loadu_si128((const __m128i*)(text+15)),1);
+    seps=_mm256_shuffle_epi8(v,gatherSeps);
+    __m256i g=_mm256_shuffle_epi8(v,gather);
+    __m256i lo=_mm256_and_si256(g,nibble);
+    __m256i hi=_mm256_and_si256(_mm256_srli_epi16(g,4),nibble);
+    __m256i isDigit=_mm256_cmpeq_epi8(hi,_mm256_set1_epi8(3));
+    __m256i isLow=_mm256_cmpeq_epi8(_mm256_or_si256(hi,two),_mm256_set1_epi8(6));
+    __m256i isHigh=_mm256_cmpeq_epi8(_mm256_or_si256(hi,two),_mm256_set1_epi8(7));
+    __m256i ranks=_mm256_or_si256(_mm256_and_si256(isDigit,_mm256_shuffle_epi8(t.digits,lo)),
+        _mm256_or_si256(_mm256_and_si256(isLow,_mm256_shuffle_epi8(t.ranksLow,lo)),_mm256_and_si256(isHigh,_mm256_shuffle_epi8(t.ranksHigh,lo))));
+    __m256i suits=_mm256_or_si256(_mm256_and_si256(isLow,_mm256_shuffle_epi8(t.suitsLow,lo)),
+        _mm256_or_si256(_mm256_and_si256(isHigh,_mm256_shuffle_epi8(t.suitsHigh,lo)),isDigit));
+    __m256i values=_mm256_blendv_epi8(suits,ranks,rankLanes);
+    values=_mm256_or_si256(values,_mm256_andnot_si256(_mm256_or_si256(isDigit,_mm256_or_si256(isLow,isHigh)),ones));
+    __m256i suit=_mm256_srli_si256(values,8);
+    __m256i bad=_mm256_or_si256(_mm256_cmpeq_epi8(values,ones),_mm256_cmpeq_epi8(suit,ones));
+    __m256i packed=_mm256_add_epi8(_mm256_add_epi8(values,values),_mm256_add_epi8(values,values));
+    return _mm256_or_si256(_mm256_add_epi8(packed,suit),bad);
+}
+
+///\brief Stores the ten bytes of a decodeTen() result (8 bytes more are written)
+__attribute__((target("avx2")))
+static inline void storeTen(uint8_t* out, __m256i v) {
+    _mm_storel_epi64((__m128i*)out,_mm256_castsi256_si128(v));
+    _mm_storel_epi64((__m128i*)(out+5),_mm256_extracti128_si256(v,1));
+}
+
+///\brief decodeTokens() with AVX2, 30 tokens per step: three independent decodeTen()
+__attribute__((target("avx2")))
+inline size_t decodeTokensAvx2(const char* text, size_t n, uint8_t* cards, char* seps) {
+    static const TokenTables tables;
+    TokenTablesAvx2 t;
+    t.digits=broadcastTable(tables.digits);
+    t.ranksLow=broadcastTable(tables.ranksLow);
+    t.ranksHigh=broadcastTable(tables.ranksHigh);
+    t.suitsLow=broadcastTable(tables.suitsLow);
+    t.suitsHigh=broadcastTable(tables.suitsHigh);
+    size_t i=0;
+    //91 characters are read for 90
+    for (; i+31<=n; i+=30) {
+        __m256i s0, s1, s2;
+        __m256i c0=decodeTen(text+3*i,t,s0);
+        __m256i c1=decodeTen(text+3*i+30,t,s1);
+        __m256i c2=decodeTen(text+3*i+60,t,s2);
+        storeTen(cards+i,c0);
+        storeTen(cards+i+10,c1);
+        storeTen(cards+i+20,c2);
+        storeTen((uint8_t*)seps+i,s0);
+        storeTen((uint8_t*)seps+i+10,s1);
+        storeTen((uint8_t*)seps+i+20,s2);
+    }
+    //31 characters are read for 30
+    for (; i+11<=n; i+=10) {
+        __m256i s;
+        storeTen(cards+i,decodeTen(text+3*i,t,s));
+        storeTen((uint8_t*)seps+i,s);
+    }
+    return i;
+}
+#endif
+
+///\brief Decodes tokens with the widest instructions of the processor (AVX2, SSSE3 or none), see decodeTokens()
+///\pre the text holds 3*n characters, cards and seps have room for n+8 bytes
+inline void decodeTokensSimd(const char* text, size_t n, uint8_t* cards, char* seps) {
+    size_t done=0;
+#ifdef POKER_X86
+    static const bool avx2=__builtin_cpu_supports("avx2");
+    static const bool ssse3=__builtin_cpu_supports("ssse3");
+    if (avx2) done=decodeTokensAvx2(text,n,cards,seps);
+    else if (ssse3) done=decodeTokensSsse3(text,n,cards,seps);
+#endif
+    decodeTokens(text+3*done,n-done,cards+done,seps+done);
+}
+
+///\brief Parses fixed width lines of hands ("8C 7D 6S 4D 5S 7S 2S 5D 8S 6C\n") into a batch
+///
+///Every card is a token of three characters: rank, suit and a blank (the new line ending the line), so the text is decoded
+///block by block with decodeTokensSimd(). A block is checked at once: no byte decoded as a wrong card, the separators equal
+///to the expected ones; then HandBatch::appendCards() adds its hands, a duplicate being a bit already set in the card masks
+///of a line. Only a wrong block is checked again line by line to report the error. Ranks and suits are upper case or
+///lower case, T or X for tens.
+///@param[in] text: the lines, the last new line may be missing \n
+///@param[in] handCards: cards in a hand (5 to 7) \n
+///@param[in] lineHands: hands in a line, at most 64 cards in a line \n
+///@param[out] out: receives the hands, in the order of the text \n
+///@param[out] error: position and reason of the first error \n
+///@return the number of lines, -1 on errors (the hands before the wrong line are in out)
+inline long parseHandLines(TextView text, int handCards, int lineHands, HandBatch& out, ParseError& error) {
+    assert(handCards>=5 && handCards<=7 && lineHands>=1);//check preconditions
+
+    static const CardParser parser;
+    //the buffers hold 256 lines of at most 64 cards
+    if (lineHands>64/handCards) {
+        error.position=0;
+        error.message="line too long";
+        return -1;
+    }
+    const int line=handCards*lineHands;
+    size_t tokens=(text.size+1)/3;
+    if (text.size%3==1 || tokens%line) {
+        error.position=text.size;
+        error.message="incomplete line";
+        return -1;
+    }
+    out.reserve(out.size()+tokens/handCards);
+
+    //separators expected in a block
+    const size_t block=line*256;
+    char pattern[64*256];
+    for (size_t i=0; i<std::min(block,tokens); i++)
+        pattern[i]=(i%line==(size_t)line-1) ? '\n' : ' ';
+
+    uint8_t cards[64*256+16];
+    char seps[64*256+16];
+    for (size_t first=0; first<tokens; first+=block) {
+        size_t n=std::min(block,tokens-first);
+        const char* base=text.data+3*first;
+        //the last token may lack its new line
+        bool open=(first+n==tokens && text.size%3==2);
+        decodeTokensSimd(base,n-open,cards,seps);
+        if (open) {
+            int c=parser.card(base[3*(n-1)],base[3*(n-1)+1]);
+            cards[n-1]=(c<0) ? 0xFF : c;
+            seps[n-1]='\n';
+        }
+
+        //lines before the first wrong card or separator
+        size_t good=n;
+        uint8_t wrong=0;
+        for (size_t i=0; i<n; i++)
+            wrong|=cards[i];
+        if ((wrong&0x80) || memcmp(seps,pattern,n)!=0) {
+            good=0;
+            while (good<n && memcmp(seps+good,pattern,line)==0 && *std::max_element(cards+good,cards+good+line)<52)
+                good+=line;
+        }
+        size_t hands=good/handCards, added;
+        switch (handCards) {
+        case 5:
+            added=out.appendCards<5>(cards,hands,lineHands);
+            break;
+        case 6:
+            added=out.appendCards<6>(cards,hands,lineHands);
+            break;
+        default:
+            added=out.appendCards<7>(cards,hands,lineHands);
+        }
+        if (added==n/handCards) continue;
+
+        //find the first wrong character of the wrong line
+        size_t l=added*handCards, at=3*(first+l);
+        CardMask seen=0;
+        for (int i=0; i<line; i++, at+=3) {
+            if (parser.card(text.data[at],'S')<0) {
+                error.position=at;
+                error.message="bad rank";
+            } else if (parser.card('A',text.data[at+1])<0) {
+                error.position=at+1;
+                error.message="bad suit";
+            } else if (seen&cardBit(cards[l+i])) {
+                error.position=at;
+                error.message="duplicated card";
+            } else if (seps[l+i]!=pattern[i]) {
+                error.position=at+2;
+                error.message=(pattern[i]==' ') ? "missing blank after card" : "missing new line";
+            } else {
+                seen|=cardBit(cards[l+i]);
+                continue;
+            }
+            return -1;
+        }
+    }
+    return tokens/line;
+}
+
+///\brief Machine readable formats of ResultWriter
+enum OutputFormat { CsvOutput, JsonOutput, BinaryOutput };
+
+///\brief Writes evaluation results in bulk: no allocation, no locale, one write per buffer
+///
+///Records hold the cards of a hand, its category, its strength key and optionally a showdown result code
+///(as PokerHand::wins(), -1 for none). Cards are written as in PlayCard::print(), highest rank first.
+///\code
+///CSV:    AS KD QH JC XS,4,4980736,1
+///JSON:   {"cards":"AS KD QH JC XS","category":4,"key":4980736,"winner":1}
+///binary: 16 bytes: uint64 mask, int32 key, int8 category, int8 winner, 2 bytes of padding
+///\endcode
+class ResultWriter {
+private:
+    FILE* file;
+    OutputFormat format;
+    std::vector<char> buffer;
+    size_t used;
+    bool ok;
+
+    //not copyable
+    ResultWriter(const ResultWriter&);
+    ResultWriter& operator=(const ResultWriter&);
+
+    ///\brief Makes room for n characters
+    void room(size_t n) {
+        if (used+n>buffer.size()) flush();
+    }
+
+    void put(const char* s, size_t n) {
+        std::copy(s,s+n,&buffer[used]);
+        used+=n;
+    }
+
+    void putInt(long v) {
+        char digits[24];
+        int n=0;
+        bool negative=v<0;
+        unsigned long u=negative ? -(unsigned long)v : v;
+        do {
+            digits[n++]='0'+u%10;
+            u/=10;
+        } while (u);
+        if (negative) buffer[used++]='-';
+        while (n) buffer[used++]=digits[--n];
+    }
+
+    ///\brief Cards of a mask, highest rank first, separated by blanks
+    void putCards(CardMask m) {
+        static const char names[]="2S2C2D2H3S3C3D3H4S4C4D4H5S5C5D5H6S6C6D6H7S7C7D7H8S8C8D8H9S9C9D9H"
+            "XSXCXDXHJSJCJDJHQSQCQDQHKSKCKDKHASACADAH";
+        int s[4]={suitRanks(m,0),suitRanks(m,1),suitRanks(m,2),suitRanks(m,3)};
+        int any=s[0]|s[1]|s[2]|s[3];
+        bool first=true;
+        while (any) {
+            int r=topRank(any);
+            any&=~(1<<r);
+            for (int i=0; i<4; i++)
+                if (s[i]&(1<<r)) {
+                    if (!first) buffer[used++]=' ';
+                    put(names+2*(r*4+i),2);
+                    first=false;
+                }
+        }
+    }
+
+public:
+    ///\brief Writes to an open file through a buffer of bufferSize bytes
+    ///\pre \f$ bufferSize \geq 256 \f$
+    ResultWriter(FILE* file, OutputFormat format, size_t bufferSize=1<<16) : file(file), format(format), buffer(bufferSize), used(0), ok(true) {
+        assert(bufferSize>=256);//check preconditions
+    }
+
+    ~ResultWriter() {
+        flush();
+    }
+
+    ///\brief Column names, for CSV only
+    void header() {
+        if (format!=CsvOutput) return;
+        room(32);
+        put("cards,category,key,winner\n",26);
+    }
+
+    ///\brief Adds a record
+    ///\pre \f$ countCards(hand) \leq 7 \wedge -1 \leq winner \leq 2 \f$
+    void write(CardMask hand, int key, int winner=-1) {
+        assert(countCards(hand)<=7 && winner>=-1 && winner<=2);//check preconditions
+        room(128);
+        if (format==BinaryOutput) {
+            char record[16];
+            int8_t category=keyCategory(key), code=winner;
+            memcpy(record,&hand,8);
+            memcpy(record+8,&key,4);
+            memcpy(record+12,&category,1);
+            memcpy(record+13,&code,1);
+            record[14]=record[15]=0;
+            put(record,16);
+        } else if (format==CsvOutput) {
+            putCards(hand);
+            buffer[used++]=',';
+            putInt(keyCategory(key));
+            buffer[used++]=',';
+            putInt(key);
+            buffer[used++]=',';
+            if (winner>=0) putInt(winner);
+            buffer[used++]='\n';
+        } else {
+            put("{\"cards\":\"",10);
+            putCards(hand);
+            put("\",\"category\":",13);
+            putInt(keyCategory(key));
+            put(",\"key\":",7);
+            putInt(key);
+            if (winner>=0) {
+                put(",\"winner\":",10);
+                putInt(winner);
+            }
+            put("}\n",2);
+        }
+    }
+
+    ///\brief Adds the records of a span of hands and their keys
+    void write(const HandBatch::Span& hands, const int* keys) {
+        for (size_t i=0; i<hands.size(); i++)
+            write(hands[i],keys[i]);
+    }
+
+    ///\brief Writes the buffer to the file, returns false if any write failed
+    bool flush() {
+        if (used>0) ok&=fwrite(&buffer[0],1,used,file)==used;
+        used=0;
+        return ok;
+    }
+};
+
+///\brief Adler-32 checksum of n bytes, continuing from sum (1 for a new checksum) (pure function)
+inline uint32_t adler32(const unsigned char* data, size_t n, uint32_t sum=1) {
+    uint32_t a=sum&0xFFFF, b=sum>>16;
+    while (n>0) {
+        size_t chunk=n<5552 ? n : 5552;//largest chunk that cannot overflow b before the modulo
+        n-=chunk;
+        while (chunk--) {
+            a+=*data++;
+            b+=a;
+        }
+        a%=65521;
+        b%=65521;
+    }
+    return b<<16|a;
+}
+
+///\brief Evaluation results as columns: the unit read and written by ColumnWriter and ColumnReader
+class ResultColumns {
+public:
+    ///strength keys
+    std::vector<int> keys;
+    ///keyCategory() of the keys, 0 to 9
+    std::vector<int8_t> categories;
+    ///result codes of PokerHand::wins(), -1 for none
+    std::vector<int8_t> winners;
+
+    size_t size() const {
+        return keys.size();
+    }
+
+    void clear() {
+        keys.clear();
+        categories.clear();
+        winners.clear();
+    }
+
+    ///\brief Adds a result
+    ///\pre \f$ -1 \leq winner \leq 2 \f$
+    void push_back(int key, int winner=-1) {
+        assert(key>=0 && winner>=-1 && winner<=2);//check preconditions
+        keys.push_back(key);
+        categories.push_back(keyCategory(key));
+        winners.push_back(winner);
+    }
+};
+
+///\brief Writes evaluation results in compressed column blocks
+///
+///Every block of at most blockSize results is a header of six uint32: magic number, count of results,
+///bytes of each of the three columns and Adler-32 checksum of the columns; then the columns:
+///categories packed by 4 bits, winners packed by 2 bits (3 for none), keys as zigzag varint deltas
+///from the previous key of the block. Sorted keys, as produced by rankHands(), take one or two bytes each.
+class ColumnWriter {
+private:
+    FILE* file;
+    size_t blockSize;
+    ResultColumns pending;
+    std::vector<unsigned char> bytes;
+    bool ok;
+
+    //not copyable
+    ColumnWriter(const ColumnWriter&);
+    ColumnWriter& operator=(const ColumnWriter&);
+
+public:
+    static const uint32_t magic=0x314B4350;//"PCK1"
+    ///\brief Results in a block at most, ColumnReader rejects larger counts as corrupted
+    static const uint32_t maxBlockSize=1<<16;
+
+    ///\brief Writes to an open binary file in blocks of blockSize results
+    ///\pre \f$ 0 < blockSize \leq maxBlockSize \f$
+    ColumnWriter(FILE* file, size_t blockSize=maxBlockSize) : file(file), blockSize(blockSize), ok(true) {
+        assert(blockSize>0 && blockSize<=maxBlockSize);//check preconditions
+    }
+
+    ~ColumnWriter() {
+        flush();
+    }
+
+    ///\brief Adds a result
+    ///\pre \f$ -1 \leq winner \leq 2 \f$
+    void write(int key, int winner=-1) {
+        pending.push_back(key,winner);
+        if (pending.size()==blockSize) flush();
+    }
+
+    ///\brief Adds n results without showdown codes
+    void write(const int* keys, size_t n) {
+        for (size_t i=0; i<n; i++)
+            write(keys[i]);
+    }
+
+    ///\brief Encodes the pending results as a block, returns false if any write failed
+    bool flush() {
+        size_t n=pending.size();
+        if (n==0) return ok;
+        size_t categoryBytes=(n+1)/2, winnerBytes=(n+3)/4;
+        bytes.assign(categoryBytes+winnerBytes+5*n,0);
+        unsigned char* categories=&bytes[0];
+        unsigned char* winners=categories+categoryBytes;
+        for (size_t i=0; i<n; i++) {
+            categories[i/2]|=pending.categories[i]<<(i%2*4);
+            winners[i/4]|=(pending.winners[i]&3)<<(i%4*2);
+        }
+        unsigned char* keys=winners+winnerBytes;
+        unsigned char* p=keys;
+        int previous=0;
+        for (size_t i=0; i<n; i++) {
+            int delta=pending.keys[i]-previous;
+            uint32_t z=(uint32_t)delta<<1^(uint32_t)(delta>>31);
+            previous=pending.keys[i];
+            while (z>=0x80) {
+                *p++=z|0x80;
+                z>>=7;
+            }
+            *p++=z;
+        }
+        size_t size=p-categories;
+        uint32_t header[6]={magic,(uint32_t)n,(uint32_t)categoryBytes,(uint32_t)winnerBytes,(uint32_t)(p-keys),adler32(categories,size)};
+        ok&=fwrite(header,sizeof(header),1,file)==1;
+        ok&=fwrite(categories,1,size,file)==size;
+        pending.clear();
+        return ok;
+    }
+};
+
+///\brief Reads the blocks written by ColumnWriter, verifying their checksums
+class ColumnReader {
+private:
+    FILE* file;
+    std::vector<unsigned char> bytes;
+    bool corrupt;
+
+    //not copyable
+    ColumnReader(const ColumnReader&);
+    ColumnReader& operator=(const ColumnReader&);
+
+public:
+    explicit ColumnReader(FILE* file) : file(file), corrupt(false) {
+    }
+
+    ///\brief Replaces block by the next block of the file, returns false at the end of the file or on errors
+    bool next(ResultColumns& block) {
+        block.clear();
+        uint32_t header[6];
+        if (corrupt) return false;
+        size_t got=fread(header,1,sizeof(header),file);
+        if (got==0 && feof(file)) return false;
+        size_t n=header[1], categoryBytes=header[2], winnerBytes=header[3], keyBytes=header[4];
+        corrupt=got!=sizeof(header) || header[0]!=ColumnWriter::magic || n==0 || n>ColumnWriter::maxBlockSize
+            || categoryBytes!=(n+1)/2 || winnerBytes!=(n+3)/4 || keyBytes<n || keyBytes>5*n;
+        if (corrupt) return false;
+        bytes.resize(categoryBytes+winnerBytes+keyBytes);
+        corrupt=fread(&bytes[0],1,bytes.size(),file)!=bytes.size() || adler32(&bytes[0],bytes.size())!=header[5];
+        if (corrupt) return false;
+        const unsigned char* categories=&bytes[0];
+        const unsigned char* winners=categories+categoryBytes;
+        const unsigned char* p=winners+winnerBytes;
+        const unsigned char* end=p+keyBytes;
+        block.keys.resize(n);
+        block.categories.resize(n);
+        block.winners.resize(n);
+        for (size_t i=0; i<n; i++)
+            block.categories[i]=categories[i/2]>>(i%2*4)&15;
+        for (size_t i=0; i<n; i++) {
+            int w=winners[i/4]>>(i%4*2)&3;
+            block.winners[i]=w==3 ? -1 : w;
+        }
+        int previous=0;
+        for (size_t i=0; i<n && !corrupt; i++) {
+            if (p==end) {
+                corrupt=true;
+                break;
+            }
+            uint32_t z=*p++;
+            if (z&0x80) {//more bytes, at most 5 in all
+                z&=0x7F;
+                for (int shift=7; ; shift+=7) {
+                    if (p==end || shift>28) {
+                        corrupt=true;
+                        break;
+                    }
+                    z|=(uint32_t)(*p&0x7F)<<shift;
+                    if (!(*p++&0x80)) break;
+                }
+            }
+            previous+=(int)(z>>1)^-(int)(z&1);
+            block.keys[i]=previous;
+        }
+        corrupt=corrupt || p!=end;
+        if (corrupt) block.clear();
+        return !corrupt;
+    }
+
+    ///\brief True if a block was truncated, did not match its checksum or was not written by ColumnWriter (more than ColumnWriter::maxBlockSize results)
+    bool corrupted() const {
+        return corrupt;
+    }
+};
+
+///\brief The 24 permutations of the suits
+///
+///perm[i][s] is the suit that takes the place of s
+class SuitPermutations {
+public:
+    int perm[24][4];
+
+    SuitPermutations() {
+        int p[4]={0,1,2,3};
+        int i=0;
+        do {
+            for (int s=0; s<4; s++)
+                perm[i][s]=p[s];
+            i++;
+        } while (std::next_permutation(p,p+4));
+        assert(i==24);//check postcondition
+    }
+};
+
+///\brief Exchanges the suits of a mask (pure function)
+///\pre perm is a permutation of the suits
+inline CardMask permuteSuits(CardMask m, const int* perm) {
+    CardMask result=0;
+    for (int s=0; s<4; s++)
+        result|=(CardMask)suitRanks(m,s)<<(perm[s]*16);
+    assert(countCards(result)==countCards(m));//check postcondition
+    return result;
+}
+
+///\brief Canonical representative of a tuple of masks under suit isomorphism
+///
+///All the masks are renamed with the same suit permutation, the lexicographically smallest tuple is chosen:
+///two tuples are isomorphic if and only if they have the same canonical representative.
+///@param[in,out] masks: the tuple, replaced by its canonical representative \n
+///@param[in] n: size of the tuple \n
+inline void canonicalSuits(CardMask* masks, int n) {
+    static const SuitPermutations perms;
+    std::vector<CardMask> best(masks,masks+n);
+    std::vector<CardMask> cur(n);
+    for (int p=1; p<24; p++) {
+        for (int i=0; i<n; i++)
+            cur[i]=permuteSuits(masks[i],perms.perm[p]);
+        if (std::lexicographical_compare(cur.begin(),cur.end(),best.begin(),best.end()))
+            best=cur;
+    }
+    std::copy(best.begin(),best.end(),masks);
+}
+
+///\brief Hand strength and hand potential of two hole cards on a board
+///
+///Computed against one opponent holding any two unseen cards, the definitions are the ones of
+///Billings et al. "Opponent modeling in poker": ahead, tied and behind are the result codes of PokerHand::wins()
+class HandPotential {
+public:
+    ///probability of being ahead now (ties count half)
+    double hs;
+    ///probability of falling behind to ahead or tied when the board is completed
+    double ppot;
+    ///probability of falling from ahead or tied to behind when the board is completed
+    double npot;
+    ///effective hand strength: \f$ hs*(1-npot)+(1-hs)*ppot \f$
+    double ehs;
+
+    HandPotential() {
+        hs=ppot=npot=ehs=0;
+    }
+};
+
+///\brief Computes HandPotential metrics, caching them by suit isomorphism
+///
+///Every opponent holding is evaluated against every completion of the board. The hero's keys are computed
+///once per completion and the opponent's cards are added incrementally to the board mask.
+class HandPotentialCalculator {
+private:
+    ///results by canonical (board, hole)
+    std::map<std::pair<CardMask,CardMask>,HandPotential> cache;
+
+    ///\brief The enumeration itself
+    HandPotential enumerate(CardMask hole, CardMask board) {
+        CardMask used=hole|board;
+        int missing=5-countCards(board);
+
+        std::vector<int> deck;
+        for (int c=0; c<52; c++)
+            if (!(used&cardBit(c))) deck.push_back(c);
+
+        //board completions and the hero's final keys
+        std::vector<CardMask> runouts;
+        if (missing==0)
+            runouts.push_back(0);
+        for (unsigned int i=0; missing>0 && i<deck.size(); i++) {
+            if (missing==1)
+                runouts.push_back(cardBit(deck[i]));
+            else
+                for (unsigned int j=i+1; j<deck.size(); j++)
+                    runouts.push_back(cardBit(deck[i])|cardBit(deck[j]));
+        }
+        //the known cards are evaluated once, each completion only adds its cards to them
+        IncrementalHand hero(hole|board);
+        std::vector<int> heroKeys(runouts.size());
+        for (unsigned int r=0; r<runouts.size(); r++) {
+            IncrementalHand later=hero;
+            later.add(runouts[r]);
+            heroKeys[r]=later.key();
+        }
+        int heroNow=hero.key();
+
+        //HP[now][later] indexed with the wins() result codes: 0 tied, 1 ahead, 2 behind
+        double hp[3][3]={{0,0,0},{0,0,0},{0,0,0}};
+        double total[3]={0,0,0};
+        IncrementalHand known(board);
+        for (unsigned int i=0; i<deck.size(); i++)
+            for (unsigned int j=i+1; j<deck.size(); j++) {
+                IncrementalHand opp=known;
+                opp.add(cardBit(deck[i])|cardBit(deck[j]));
+                int now=showdown(heroNow,opp.key());
+                total[now]++;
+
+                //the completions sharing a card with the opponent are skipped
+                for (unsigned int r=0; missing>0 && r<runouts.size(); r++)
+                    if (!(runouts[r]&opp.cards)) {
+                        IncrementalHand later=opp;
+                        later.add(runouts[r]);
+                        hp[now][showdown(heroKeys[r],later.key())]++;
+                    }
+            }
+
+        HandPotential result;
+        result.hs=(total[1]+total[0]/2)/(total[0]+total[1]+total[2]);
+        double behind=hp[2][0]+hp[2][1]+hp[2][2];
+        double tied=hp[0][0]+hp[0][1]+hp[0][2];
+        double ahead=hp[1][0]+hp[1][1]+hp[1][2];
+        if (behind+tied>0)
+            result.ppot=(hp[2][1]+hp[2][0]/2+hp[0][1]/2)/(behind+tied/2);
+        if (ahead+tied>0)
+            result.npot=(hp[1][2]+hp[0][2]/2+hp[1][0]/2)/(ahead+tied/2);
+        result.ehs=result.hs*(1-result.npot)+(1-result.hs)*result.ppot;
+        return result;
+    }
+
+public:
+    ///\brief Metrics of the hole cards on the board
+    ///\pre two hole cards, three to five board cards, no duplicates
+    ///\code
+    ///context HandPotentialCalculator::compute(hole: CardMask, board: CardMask): HandPotential
+    ///    pre cards: countCards(hole)=2 && 3<=countCards(board)<=5 && (hole & board)=0
+    ///\endcode
+    ///\post all the metrics are probabilities: \f$ 0 \leq hs,ppot,npot,ehs \leq 1 \f$
+    ///\post isomorphic inputs have the same result
+    HandPotential compute(CardMask hole, CardMask board) {
+        //check preconditions
+        assert(countCards(hole)==2);
+        assert(countCards(board)>=3 && countCards(board)<=5);
+        assert((hole&board)==0);
+
+        CardMask key[2]={board,hole};
+        canonicalSuits(key,2);
+        std::pair<CardMask,CardMask> k(key[0],key[1]);
+        std::map<std::pair<CardMask,CardMask>,HandPotential>::iterator it=cache.find(k);
+        if (it!=cache.end()) return it->second;
+
+        HandPotential result=enumerate(key[1],key[0]);
+        cache[k]=result;
+
+        //check postconditions
+        assert(result.hs>=0 && result.hs<=1);
+        assert(result.ppot>=0 && result.ppot<=1);
+        assert(result.npot>=0 && result.npot<=1);
+        assert(result.ehs>=0 && result.ehs<=1);
+        return result;
+    }
+
+    ///\brief Metrics of many (hole, board) pairs at once
+    ///\post \f$ \forall {0 \leq i < n}, results_i=compute(holes_i, boards_i) \f$
+    void computeBatch(const CardMask* holes, const CardMask* boards, HandPotential* results, int n) {
+        for (int i=0; i<n; i++)
+            results[i]=compute(holes[i],boards[i]);
+    }
+
+    ///\brief Number of distinct (canonical) situations computed so far
+    int cached() {
+        return cache.size();
+    }
+};
+
+///\brief Number of processors available to parallel tools
+inline int hardwareThreads() {
+    long n=sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0 ? (int)n : 1;
+}
+
+///\brief Shared state of a parallelFor() run
+template<class Body>
+class ParallelFor {
+public:
+    Body* body;
+    int next;
+    int end;
+    int chunk;
+
+    ///\brief Thread with its index in the pool
+    class Worker {
+    public:
+        ParallelFor* pool;
+        int thread;
+    };
+
+    ///\brief Takes chunks of indexes until there is nothing left
+    static void* run(void* arg) {
+        Worker* w=(Worker*)arg;
+        ParallelFor* p=w->pool;
+        for (;;) {
+            int begin=__sync_fetch_and_add(&p->next,p->chunk);
+            if (begin>=p->end) break;
+            int stop=std::min(begin+p->chunk,p->end);
+            for (int i=begin; i<stop; i++)
+                (*p->body)(i,w->thread);
+        }
+        return 0;
+    }
+};
+
+///\brief Calls body(i, thread) for all \f$ begin \leq i < end \f$ on a pool of threads
+///
+///Indexes are handed out in chunks, thread is the index of the calling thread in the pool (\f$ 0 \leq thread < threads \f$).
+///\pre \f$ threads \geq 1 \wedge chunk \geq 1 \f$
+template<class Body>
+void parallelFor(int begin, int end, int threads, Body& body, int chunk=1) {
+    assert(threads>=1 && chunk>=1);//check preconditions
+
+    ParallelFor<Body> p;
+    p.body=&body;
+    p.next=begin;
+    p.end=end;
+    p.chunk=chunk;
+    std::vector<typename ParallelFor<Body>::Worker> workers(threads);
+    std::vector<pthread_t> ids(threads);
+    for (int t=0; t<threads; t++) {
+        workers[t].pool=&p;
+        workers[t].thread=t;
+    }
+    //the calling thread works as thread 0
+    for (int t=1; t<threads; t++)
+        pthread_create(&ids[t],0,ParallelFor<Body>::run,&workers[t]);
+    ParallelFor<Body>::run(&workers[0]);
+    for (int t=1; t<threads; t++)
+        pthread_join(ids[t],0);
+}
+
+///\brief Stable sort of 24 bit keys, descending, by a parallel LSD radix sort
+///
+///Each of the three passes sorts by 8 bits: threads count the digits of their part of the array, the counts are summed
+///digit by digit and thread by thread, then every thread moves its part in order. Passes where all the keys share the digit are skipped.
+///@param[out] order: the indexes of the keys, highest key first, equal keys by increasing index \n
+///\pre \f$ \forall i, 0 \leq keys_i < 2^{24} \f$
+class RadixSort {
+private:
+    const int* keys;
+    size_t n;
+    int threads;
+    std::vector<uint32_t> srcKeys, dstKeys, srcIdx, dstIdx;
+    std::vector<size_t> counts;
+    int shift;
+
+    size_t chunkBegin(int t) const {
+        return n*t/threads;
+    }
+
+    ///\brief Counts the digits of a part
+    class Count {
+    public:
+        RadixSort* r;
+
+        void operator()(int t, int) {
+            size_t* c=&r->counts[t*256];
+            std::fill(c,c+256,0);
+            for (size_t i=r->chunkBegin(t); i<r->chunkBegin(t+1); i++)
+                c[(r->srcKeys[i]>>r->shift)&0xFF]++;
+        }
+    };
+
+    ///\brief Moves a part, counts hold the first destination of every digit
+    class Scatter {
+    public:
+        RadixSort* r;
+
+        void operator()(int t, int) {
+            size_t* c=&r->counts[t*256];
+            for (size_t i=r->chunkBegin(t); i<r->chunkBegin(t+1); i++) {
+                size_t p=c[(r->srcKeys[i]>>r->shift)&0xFF]++;
+                r->dstKeys[p]=r->srcKeys[i];
+                r->dstIdx[p]=r->srcIdx[i];
+            }
+        }
+    };
+
+public:
+    RadixSort(const int* keys, size_t n, int threads) : keys(keys), n(n), threads(threads) {
+        assert(threads>=1);//check preconditions
+    }
+
+    void sort(uint32_t* order) {
+        //descending keys sort ascending once inverted
+        srcKeys.resize(n);
+        srcIdx.resize(n);
+        for (size_t i=0; i<n; i++) {
+            assert(keys[i]>=0 && keys[i]<(1<<24));//check preconditions
+            srcKeys[i]=0xFFFFFF-keys[i];
+            srcIdx[i]=i;
+        }
+        dstKeys.resize(n);
+        dstIdx.resize(n);
+        counts.resize(threads*256);
+
+        Count count;
+        count.r=this;
+        Scatter scatter;
+        scatter.r=this;
+        for (shift=0; shift<24; shift+=8) {
+            parallelFor(0,threads,threads,count);
+            size_t next=0;
+            bool skip=false;
+            for (int d=0; d<256; d++)
+                for (int t=0; t<threads; t++) {
+                    size_t c=counts[t*256+d];
+                    skip|=(c==n && n>0);
+                    counts[t*256+d]=next;
+                    next+=c;
+                }
+            if (skip) continue;
+            parallelFor(0,threads,threads,scatter);
+            srcKeys.swap(dstKeys);
+            srcIdx.swap(dstIdx);
+        }
+        std::copy(srcIdx.begin(),srcIdx.end(),order);
+
+        //check postconditions
+        for (size_t i=1; i<n; i++)
+            assert(keys[order[i-1]]>keys[order[i]] || (keys[order[i-1]]==keys[order[i]] && order[i-1]<order[i]));
+    }
+};
+
+///\brief Hands ordered by strength, with their ties
+class HandRanking {
+public:
+    ///strength key of every hand (evalMask())
+    std::vector<int> keys;
+    ///indexes of the hands, strongest first, equal hands in input order
+    std::vector<uint32_t> order;
+    ///the hands \f$ order_{groups_g} \ldots order_{groups_{g+1}-1} \f$ tie, the last item is order.size()
+    std::vector<uint32_t> groups;
+
+    ///\brief Number of tie groups (pure function)
+    size_t groupCount() const {
+        return groups.empty() ? 0 : groups.size()-1;
+    }
+};
+
+///\brief Evaluates a span of hands on many threads
+class SpanEvaluation {
+public:
+    const HandBatch::Span* span;
+    int* keys;
+
+    void operator()(int i, int) {
+        const size_t B=4096;
+        size_t first=i*B;
+        HandBatch::Span part(span->batch,span->first+first,std::min(B,span->count-first));
+        part.evaluate(keys+first);
+    }
+};
+
+///\brief Ranks the hands of a span by strength
+///
+///Keys are computed on threads, in blocks of a batch, and radix sorted. No hand is compared to another.
+///\post \f$ \forall i, keys_{order_i} \geq keys_{order_{i+1}} \f$, groups are the runs of equal keys
+inline void rankHands(const HandBatch::Span& hands, int threads, HandRanking& result) {
+    size_t n=hands.size();
+    result.keys.resize(n);
+    SpanEvaluation eval;
+    eval.span=&hands;
+    eval.keys=n ? &result.keys[0] : 0;
+    parallelFor(0,(n+4095)/4096,threads,eval);
+
+    result.order.resize(n);
+    RadixSort sorter(eval.keys,n,threads);
+    sorter.sort(n ? &result.order[0] : 0);
+
+    result.groups.clear();
+    for (size_t i=0; i<n; i++)
+        if (i==0 || result.keys[result.order[i]]!=result.keys[result.order[i-1]])
+            result.groups.push_back(i);
+    result.groups.push_back(n);
+}
+
+///\brief Appends to out all the subsets of k cards of deck, in lexicographic order
+///\post \f$ out.size() \f$ grows by \f$ \binom{deck.size()}{k} \f$
+inline void cardSubsets(const std::vector<int>& deck, int k, std::vector<CardMask>& out) {
+    assert(k>=0 && k<=(int)deck.size());//check preconditions
+
+    std::vector<int> idx(k);
+    for (int i=0; i<k; i++) idx[i]=i;
+    for (;;) {
+        CardMask m=0;
+        for (int i=0; i<k; i++) m|=cardBit(deck[idx[i]]);
+        out.push_back(m);
+        int i=k-1;
+        while (i>=0 && idx[i]==(int)deck.size()-k+i) i--;
+        if (i<0) break;
+        idx[i]++;
+        for (int j=i+1; j<k; j++) idx[j]=idx[j-1]+1;
+    }
+}
+
+///\brief The Philox4x32-10 counter-based generator (Salmon et al. "Parallel random numbers: as easy as 1, 2, 3")
+///
+///Block b of key k is a bijective function of the 128 bit counter (b, stream): any block can be computed on its own.
+///blocks() computes 32 blocks at a time, round by round over arrays of lanes, so that the compiler vectorizes every round;
+///block() computes one.
+class Philox {
+public:
+    ///\brief Words 0 to 3 of out are block b of (key, stream) (pure function)
+    static void block(uint64_t key, uint64_t stream, uint64_t b, uint32_t* out) {
+        uint32_t c0=(uint32_t)b, c1=(uint32_t)(b>>32), c2=(uint32_t)stream, c3=(uint32_t)(stream>>32);
+        uint32_t k0=(uint32_t)key, k1=(uint32_t)(key>>32);
+        for (int r=0; r<10; r++) {
+            uint64_t p0=(uint64_t)c0*0xD2511F53u;
+            uint64_t p1=(uint64_t)c2*0xCD9E8D57u;
+            c0=(uint32_t)(p1>>32)^c1^k0;
+            c2=(uint32_t)(p0>>32)^c3^k1;
+            c1=(uint32_t)p1;
+            c3=(uint32_t)p0;
+            k0+=0x9E3779B9u;
+            k1+=0xBB67AE85u;
+        }
+        out[0]=c0;
+        out[1]=c1;
+        out[2]=c2;
+        out[3]=c3;
+    }
+
+    ///\brief Words \f$ 4i \ldots 4i+3 \f$ of out are block first+i of (key, stream), for \f$ 0 \leq i < n \f$ (pure function)
+    static void blocks(uint64_t key, uint64_t stream, uint64_t first, int n, uint32_t* out) {
+        //32 lanes: the lanes of a round are not completely unrolled at -O3
+        const int L=32;
+        uint32_t c0[L], c1[L], c2[L], c3[L];
+        int done=0;
+        for (; done+L<=n; done+=L) {
+            for (int i=0; i<L; i++) {
+                uint64_t b=first+done+i;
+                c0[i]=(uint32_t)b;
+                c1[i]=(uint32_t)(b>>32);
+                c2[i]=(uint32_t)stream;
+                c3[i]=(uint32_t)(stream>>32);
+            }
+            //rounds outside, lanes inside: the lanes share the round key and the inner loop vectorizes
+            uint32_t k0=(uint32_t)key, k1=(uint32_t)(key>>32);
+            for (int r=0; r<10; r++) {
+                for (int i=0; i<L; i++) {
+                    uint64_t p0=(uint64_t)c0[i]*0xD2511F53u;
+                    uint64_t p1=(uint64_t)c2[i]*0xCD9E8D57u;
+                    c0[i]=(uint32_t)(p1>>32)^c1[i]^k0;
+                    c2[i]=(uint32_t)(p0>>32)^c3[i]^k1;
+                    c1[i]=(uint32_t)p1;
+                    c3[i]=(uint32_t)p0;
+                }
+                k0+=0x9E3779B9u;
+                k1+=0xBB67AE85u;
+            }
+            for (int i=0; i<L; i++) {
+                out[4*(done+i)]=c0[i];
+                out[4*(done+i)+1]=c1[i];
+                out[4*(done+i)+2]=c2[i];
+                out[4*(done+i)+3]=c3[i];
+            }
+        }
+        //the last blocks one by one
+        for (; done<n; done++)
+            block(key,stream,first+done,out+4*done);
+    }
+};
+
+///\brief Counter-based random numbers: a stream of 32 bit words computed by Philox
+///
+///A stream is identified by a seed and a stream number (a block of samples), so any block can be generated by any thread
+///in any order and still produce the same numbers. Words are produced four at a time, lanes() fills many lanes with one call.
+class CounterRng {
+private:
+    uint32_t buffer[4];
+
+public:
+    ///Philox key
+    uint64_t key;
+    ///Philox stream
+    uint64_t stream;
+    ///index of the next word
+    uint64_t counter;
+
+    ///\brief The stream number stream of seed
+    CounterRng(uint64_t seed, uint64_t stream) : key(seed), stream(stream), counter(0) {
+    }
+
+    ///\brief Word i of the stream (pure function)
+    uint32_t at(uint64_t i) const {
+        uint32_t b[4];
+        Philox::block(key,stream,i/4,b);
+        return b[i%4];
+    }
+
+    ///\brief Next 32 random bits
+    uint32_t next() {
+        if (counter%4==0)
+            Philox::block(key,stream,counter/4,buffer);
+        return buffer[counter++%4];
+    }
+
+    ///\brief Fills out with the next n words (n rounded up to a multiple of 4 are consumed)
+    void lanes(uint32_t* out, int n) {
+        //realign on a block boundary
+        counter=(counter+3)/4*4;
+        //the whole blocks are written in place, only the last partial one goes through a buffer
+        int blocks=n/4;
+        Philox::blocks(key,stream,counter/4,blocks,out);
+        counter+=4*blocks;
+        if (n%4) {
+            uint32_t tail[4];
+            Philox::block(key,stream,counter/4,tail);
+            std::copy(tail,tail+n%4,out+4*blocks);
+            counter+=4;
+        }
+    }
+
+    ///\brief Maps a random word to \f$ [0,n) \f$ (pure function)
+    static int scale(uint32_t word, int n) {
+        return (int)(((uint64_t)word*(uint64_t)n)>>32);
+    }
+
+    ///\brief Next integer in \f$ [0,n) \f$
+    ///\pre \f$ n \geq 1 \f$
+    int below(int n) {
+        assert(n>=1);//check preconditions
+        return scale(next(),n);
+    }
+
+    ///\brief Next real in \f$ [0,1) \f$
+    double uniform() {
+        uint64_t hi=next();
+        return ((hi<<21)^(next()>>11))*(1.0/9007199254740992.0);
+    }
+};
+
+///\brief Distribution of the final equity of two hole cards over the completions of the board
+///
+///For every completion the equity against a random opponent hand is computed on the river and counted
+///in one of bins equally wide bins. With samples=0 all the completions are enumerated, otherwise
+///samples random completions are drawn from stream stream of seed (CounterRng).
+///@param[in] hole: the two hole cards \n
+///@param[in] board: zero to five board cards \n
+///@param[out] hist: the bins, summing to 1 \n
+///\pre \f$ countCards(hole)=2 \wedge countCards(board) \leq 5 \wedge hole \cap board=\emptyset \wedge bins \geq 1 \f$
+inline void equityHistogram(CardMask hole, CardMask board, int bins, int samples, uint64_t seed, uint64_t stream, float* hist) {
+    //check preconditions
+    assert(countCards(hole)==2);
+    assert(countCards(board)<=5);
+    assert((hole&board)==0);
+    assert(bins>=1);
+
+    CardMask used=hole|board;
+    int missing=5-countCards(board);
+    std::vector<int> deck;
+    for (int c=0; c<52; c++)
+        if (!(used&cardBit(c))) deck.push_back(c);
+
+    std::vector<CardMask> runouts;
+    CounterRng rng(seed,stream);
+    if (samples>0)
+        for (int i=0; i<samples; i++) {
+            CardMask r=0;
+            while (countCards(r)<missing)
+                r|=cardBit(deck[rng.below(deck.size())]);
+            runouts.push_back(r);
+        }
+    else
+        cardSubsets(deck,missing,runouts);
+
+    std::fill(hist,hist+bins,0.0f);
+    std::vector<CardMask> opps;
+    std::vector<int> keys;
+    for (unsigned int r=0; r<runouts.size(); r++) {
+        CardMask full=board|runouts[r];
+        int hero=evalMask(hole|full);
+        opps.clear();
+        for (unsigned int i=0; i<deck.size(); i++)
+            for (unsigned int j=i+1; j<deck.size(); j++) {
+                CardMask opp=cardBit(deck[i])|cardBit(deck[j]);
+                if (!(opp&runouts[r])) opps.push_back(opp|full);
+            }
+        keys.resize(opps.size());
+        evalBatch(&opps[0],&keys[0],opps.size());
+        double score=0;
+        for (unsigned int i=0; i<keys.size(); i++) {
+            int res=showdown(hero,keys[i]);
+            score+=(res==1) ? 1 : (res==0 ? 0.5 : 0);
+        }
+        int bin=(int)(score/keys.size()*bins);
+        hist[std::min(bin,bins-1)]++;
+    }
+    for (int b=0; b<bins; b++)
+        hist[b]/=runouts.size();
+}
+
+///\brief Earth mover's distance between two histograms given by their cumulative sums (pure function)
+///
+///In one dimension the EMD is the L1 distance between the cumulative distributions.
+inline float emdCumulative(const float* a, const float* b, int n) {
+    float d=0;
+    for (int i=0; i<n; i++)
+        d+=std::fabs(a[i]-b[i]);
+    return d;
+}
+
+///\brief k-means clustering of histograms under the earth mover's distance
+///
+///Histograms are stored as cumulative distributions, in rows padded to a multiple of 8 floats so that
+///the distance loop is vectorized. The assignment step runs on threads, the centers are the means of the clusters.
+class EmdKMeans {
+private:
+    int stride;
+    std::vector<float> points;
+
+    ///\brief Assigns every point to its nearest center
+    class AssignStep {
+    public:
+        EmdKMeans* km;
+        int* assign;
+        float* dist;
+        int changed;
+
+        void operator()(int i, int) {
+            const float* p=&km->points[i*km->stride];
+            int best=0;
+            float bestDist=emdCumulative(p,&km->centers[0],km->stride);
+            for (int c=1; c<km->k; c++) {
+                float d=emdCumulative(p,&km->centers[c*km->stride],km->stride);
+                if (d<bestDist) {
+                    bestDist=d;
+                    best=c;
+                }
+            }
+            if (assign[i]!=best) __sync_fetch_and_add(&changed,1);
+            assign[i]=best;
+            dist[i]=bestDist;
+        }
+    };
+
+public:
+    ///number of points
+    int n;
+    ///number of bins of the histograms
+    int bins;
+    ///number of clusters
+    int k;
+    ///the cluster centers (cumulative, padded rows)
+    std::vector<float> centers;
+
+    ///\brief Loads n histograms of bins bins each
+    ///\pre \f$ n \geq k \geq 1 \wedge bins \geq 1 \f$
+    EmdKMeans(const float* hists, int n, int bins, int k) : n(n), bins(bins), k(k) {
+        assert(k>=1 && n>=k && bins>=1);//check preconditions
+
+        stride=(bins+7)/8*8;
+        points.assign(n*stride,1.0f);
+        for (int i=0; i<n; i++) {
+            float sum=0;
+            for (int b=0; b<bins; b++) {
+                sum+=hists[i*bins+b];
+                points[i*stride+b]=sum;
+            }
+        }
+        centers.assign(k*stride,1.0f);
+    }
+
+    ///\brief Runs k-means++ seeding and at most iterations Lloyd steps
+    ///
+    ///The seeding draws from stream stream of seed (CounterRng), so the clusters only depend on (seed, stream).
+    ///@param[out] assign: the cluster of every point \n
+    ///\post \f$ \forall i, 0 \leq assign_i < k \f$
+    void run(int iterations, uint64_t seed, uint64_t stream, int threads, int* assign) {
+        std::vector<float> dist(n);
+        CounterRng rng(seed,stream);
+
+        //k-means++: the next center is drawn proportionally to the squared distance
+        int first=rng.below(n);
+        std::copy(&points[first*stride],&points[first*stride]+stride,&centers[0]);
+        for (int i=0; i<n; i++)
+            dist[i]=emdCumulative(&points[i*stride],&centers[0],stride);
+        for (int c=1; c<k; c++) {
+            double total=0;
+            for (int i=0; i<n; i++) total+=(double)dist[i]*dist[i];
+            double x=total*rng.uniform();
+            int pick=0;
+            for (pick=0; pick<n-1; pick++) {
+                x-=(double)dist[pick]*dist[pick];
+                if (x<0) break;
+            }
+            std::copy(&points[pick*stride],&points[pick*stride]+stride,&centers[c*stride]);
+            for (int i=0; i<n; i++)
+                dist[i]=std::min(dist[i],emdCumulative(&points[i*stride],&centers[c*stride],stride));
+        }
+
+        std::fill(assign,assign+n,-1);
+        AssignStep step;
+        step.km=this;
+        step.assign=assign;
+        step.dist=&dist[0];
+        for (int it=0; it<iterations; it++) {
+            step.changed=0;
+            parallelFor(0,n,threads,step,256);
+            if (step.changed==0) break;
+
+            //the centers move to the mean of their points
+            std::vector<double> sums(k*stride,0.0);
+            std::vector<int> sizes(k,0);
+            for (int i=0; i<n; i++) {
+                sizes[assign[i]]++;
+                for (int b=0; b<stride; b++)
+                    sums[assign[i]*stride+b]+=points[i*stride+b];
+            }
+            for (int c=0; c<k; c++) {
+                if (sizes[c]==0) {
+                    //an empty cluster takes the farthest point
+                    int far=std::max_element(dist.begin(),dist.end())-dist.begin();
+                    std::copy(&points[far*stride],&points[far*stride]+stride,&centers[c*stride]);
+                    dist[far]=0;
+                } else
+                    for (int b=0; b<stride; b++)
+                        centers[c*stride+b]=sums[c*stride+b]/sizes[c];
+            }
+        }
+        step.changed=0;
+        parallelFor(0,n,threads,step,256);
+
+        //check postconditions
+        for (int i=0; i<n; i++)
+            assert(assign[i]>=0 && assign[i]<k);
+    }
+};
+
+///\brief Bucket of every canonical (board, hole cards) situation
+///
+///Keys are sorted canonical pairs, so lookups are binary searches and the table is saved as two arrays.
+class BucketTable {
+public:
+    ///canonical (board, hole) pairs, sorted
+    std::vector<std::pair<CardMask,CardMask> > keys;
+    ///bucket of keys[i]
+    std::vector<uint16_t> buckets;
+
+    ///\brief Bucket of the hole cards on the board, -1 if the situation is not in the table (pure function)
+    int lookup(CardMask hole, CardMask board) const {
+        CardMask key[2]={board,hole};
+        canonicalSuits(key,2);
+        std::pair<CardMask,CardMask> k(key[0],key[1]);
+        std::vector<std::pair<CardMask,CardMask> >::const_iterator it=std::lower_bound(keys.begin(),keys.end(),k);
+        if (it==keys.end() || *it!=k) return -1;
+        return buckets[it-keys.begin()];
+    }
+
+    ///\brief Writes the table to a binary file, returns false on errors
+    bool save(const char* path) const {
+        FILE* f=fopen(path,"wb");
+        if (!f) return false;
+        uint64_t n=keys.size();
+        bool ok=fwrite(&n,sizeof(n),1,f)==1;
+        for (unsigned int i=0; ok && i<keys.size(); i++) {
+            uint64_t k[2]={keys[i].first,keys[i].second};
+            ok=fwrite(k,sizeof(k),1,f)==1;
+        }
+        if (ok && n>0) ok=fwrite(&buckets[0],sizeof(uint16_t),n,f)==n;
+        return fclose(f)==0 && ok;
+    }
+
+    ///\brief Reads a table written by save(), returns false on errors
+    bool load(const char* path) {
+        FILE* f=fopen(path,"rb");
+        if (!f) return false;
+        uint64_t n=0;
+        bool ok=fread(&n,sizeof(n),1,f)==1;
+        keys.clear();
+        for (uint64_t i=0; ok && i<n; i++) {
+            uint64_t k[2];
+            ok=fread(k,sizeof(k),1,f)==1;
+            keys.push_back(std::make_pair(k[0],k[1]));
+        }
+        buckets.assign(ok ? n : 0,0);
+        if (ok && n>0) ok=fread(&buckets[0],sizeof(uint16_t),n,f)==n;
+        fclose(f);
+        return ok;
+    }
+};
+
+///\brief Abstraction pipeline: equity histograms, EMD k-means, bucket table
+///
+///Situations are added by hole cards and board, isomorphic ones are stored once.
+class HandBucketer {
+private:
+    std::map<std::pair<CardMask,CardMask>,int> index;
+
+    ///\brief Computes the histogram of one situation
+    class HistogramStep {
+    public:
+        HandBucketer* b;
+        int bins;
+        int samples;
+        uint64_t seed;
+        float* hists;
+
+        void operator()(int i, int) {
+            equityHistogram(b->situations[i].second,b->situations[i].first,bins,samples,seed,i,&hists[i*bins]);
+        }
+    };
+
+public:
+    ///canonical (board, hole) pairs in insertion order
+    std::vector<std::pair<CardMask,CardMask> > situations;
+
+    ///\brief Adds a situation (if no isomorphic one was added before)
+    ///\pre \f$ countCards(hole)=2 \wedge countCards(board) \leq 5 \wedge hole \cap board=\emptyset \f$
+    void add(CardMask hole, CardMask board) {
+        assert(countCards(hole)==2 && countCards(board)<=5 && (hole&board)==0);//check preconditions
+
+        CardMask key[2]={board,hole};
+        canonicalSuits(key,2);
+        std::pair<CardMask,CardMask> k(key[0],key[1]);
+        if (index.find(k)==index.end()) {
+            index[k]=situations.size();
+            situations.push_back(k);
+        }
+    }
+
+    ///\brief Clusters the situations added so far in k buckets
+    ///@param[in] bins: bins of the equity histograms \n
+    ///@param[in] samples: board completions per histogram, 0 enumerates them all \n
+    ///@param[in] seed: situation i draws from stream i of seed, the k-means seeding from the stream after the last one \n
+    ///@param[out] table: the bucket of every situation \n
+    ///\pre \f$ situations.size() \geq k \geq 1 \wedge k \leq 65536 \f$
+    void run(int k, int bins, int samples, int iterations, uint64_t seed, int threads, BucketTable& table) {
+        assert(k>=1 && k<=65536 && (int)situations.size()>=k);//check preconditions
+
+        int n=situations.size();
+        std::vector<float> hists(n*bins);
+        HistogramStep step;
+        step.b=this;
+        step.bins=bins;
+        step.samples=samples;
+        step.seed=seed;
+        step.hists=&hists[0];
+        parallelFor(0,n,threads,step);
+
+        EmdKMeans km(&hists[0],n,bins,k);
+        std::vector<int> assign(n);
+        km.run(iterations,seed,n,threads,&assign[0]);
+
+        table.keys.clear();
+        table.buckets.clear();
+        for (std::map<std::pair<CardMask,CardMask>,int>::iterator it=index.begin(); it!=index.end(); it++) {
+            table.keys.push_back(it->first);
+            table.buckets.push_back(assign[it->second]);
+        }
+    }
+};
+
+///\brief Totals of a set of showdowns, seen from the hero
+class ShowdownTotals {
+public:
+    ///showdowns won, tied and lost (result codes 1, 0 and 2 of PokerHand::wins())
+    uint64_t wins, ties, losses;
+    ///showdowns by category of the hero's hand
+    uint64_t categories[9];
+
+    ShowdownTotals() {
+        wins=ties=losses=0;
+        std::fill(categories,categories+9,0);
+    }
+
+    ///\brief Number of showdowns (pure function)
+    uint64_t total() const {
+        return wins+ties+losses;
+    }
+
+    ///\brief Share of the pot won by the hero, ties count half (pure function)
+    ///\post \f$ 0 \leq result \leq 1 \f$
+    double equity() const {
+        if (total()==0) return 0;
+        return (wins+ties/2.0)/total();
+    }
+
+    ///\brief Adds the counts of other
+    void merge(const ShowdownTotals& other) {
+        wins+=other.wins;
+        ties+=other.ties;
+        losses+=other.losses;
+        for (int c=0; c<9; c++)
+            categories[c]+=other.categories[c];
+    }
+};
+
+///\brief Showdown counters owned by one thread
+///
+///Each instance fills whole cache lines, so threads never write to the same line. Only the owner writes,
+///with relaxed atomic stores: other threads can read them at any time without locks.
+class ShowdownCounters {
+public:
+    uint64_t wins, ties, losses;
+    uint64_t categories[9];
+    char pad[128-12*sizeof(uint64_t)];
+
+    ///\brief Counts a showdown with result code res (as in PokerHand::wins()) and hero category
+    ///\pre \f$ 0 \leq res \leq 2 \wedge 0 \leq category \leq 8 \f$
+    void add(int res, int category) {
+        assert(res>=0 && res<=2 && category>=0 && category<=8);//check preconditions
+
+        uint64_t* c=(res==1) ? &wins : (res==0 ? &ties : &losses);
+        __atomic_store_n(c,*c+1,__ATOMIC_RELAXED);
+        __atomic_store_n(&categories[category],categories[category]+1,__ATOMIC_RELAXED);
+    }
+
+    ///\brief Current values, safe while the owner is counting (pure function)
+    ShowdownTotals read() const {
+        ShowdownTotals t;
+        t.wins=__atomic_load_n(&wins,__ATOMIC_RELAXED);
+        t.ties=__atomic_load_n(&ties,__ATOMIC_RELAXED);
+        t.losses=__atomic_load_n(&losses,__ATOMIC_RELAXED);
+        for (int c=0; c<9; c++)
+            t.categories[c]=__atomic_load_n(&categories[c],__ATOMIC_RELAXED);
+        return t;
+    }
+};
+
+///\brief One ShowdownCounters per thread, reduced at the end of a parallel run
+///\invariant the counters are aligned to cache lines
+///\code
+///context ShowdownAccumulator
+///    inv aligned: slots mod 64 = 0
+///\endcode
+class ShowdownAccumulator {
+private:
+    ShowdownCounters* slots;
+    int threads;
+
+    ///\brief Verify that the Class Invariant holds
+    void ClassInv() const {
+        assert(((uintptr_t)slots)%64==0);
+        assert(threads>=1);
+    }
+
+    //not copyable
+    ShowdownAccumulator(const ShowdownAccumulator&);
+    ShowdownAccumulator& operator=(const ShowdownAccumulator&);
+
+public:
+    ///\brief Zeroed counters for threads threads
+    ///\pre \f$ threads \geq 1 \f$
+    ShowdownAccumulator(int threads) : threads(threads) {
+        assert(threads>=1);//check preconditions
+
+        void* p=0;
+        if (posix_memalign(&p,64,threads*sizeof(ShowdownCounters))!=0) {
+            std::cerr<<"Out of memory\n";
+            abort();
+        }
+        slots=(ShowdownCounters*)p;
+        for (int t=0; t<threads; t++)
+            slots[t]=ShowdownCounters();
+        ClassInv();//Invariant holds
+    }
+
+    ~ShowdownAccumulator() {
+        free(slots);
+    }
+
+    ///\brief The counters of a thread
+    ///\pre \f$ 0 \leq thread < threads \f$
+    ShowdownCounters& slot(int thread) {
+        assert(thread>=0 && thread<threads);//check preconditions
+        return slots[thread];
+    }
+
+    ///\brief Sum of all the threads, can be called while they are still counting (pure function)
+    ///
+    ///Threads are read in a fixed order without locks, every counter is exact at the time it is read.
+    ShowdownTotals snapshot() const {
+        ClassInv();//Invariant holds
+
+        ShowdownTotals t;
+        for (int i=0; i<threads; i++)
+            t.merge(slots[i].read());
+        return t;
+    }
+};
+
+///\brief Checks the cards of an equity question (pure function)
+///
+///Two hero cards, none or two villain cards, at most five board cards and any dead cards, all different cards of the deck,
+///with enough cards left to complete the board and, without villain, the opponent's holding.
+inline bool validEquityCards(CardMask hero, CardMask villain, CardMask board, CardMask dead) {
+    CardMask used=hero|villain|board|dead;
+    if (used&~0x1FFF1FFF1FFF1FFFUL) return false;
+    int h=countCards(hero), v=countCards(villain), b=countCards(board);
+    if (h!=2 || (v!=0 && v!=2) || b>5 || countCards(used)!=h+v+b+countCards(dead)) return false;
+    return 52-countCards(used)>=(5-b)+(villain ? 0 : 2);
+}
+
+///\brief Exact equity of two hole cards by enumerating all the boards
+///
+///The opponent holds the given two cards, or every possible holding if none is given. Completions of the board
+///are split among threads, each one counting on its own ShowdownCounters: snapshot() reports the progress of a running enumeration.
+class EquityEnumeration {
+private:
+    std::vector<CardMask> runouts;
+    std::vector<int> deck;
+    ShowdownAccumulator counters;
+
+    ///\brief Showdowns of one board completion
+    class Step {
+    public:
+        EquityEnumeration* e;
+
+        void operator()(int i, int thread) {
+            ShowdownCounters& c=e->counters.slot(thread);
+            CardMask full=e->board|e->runouts[i];
+            int hero=evalMask(e->hero|full);
+            if (e->villain) {
+                c.add(showdown(hero,evalMask(e->villain|full)),keyCategory(hero));
+                return;
+            }
+            for (unsigned int a=0; a<e->deck.size(); a++)
+                for (unsigned int b=a+1; b<e->deck.size(); b++) {
+                    CardMask opp=cardBit(e->deck[a])|cardBit(e->deck[b]);
+                    if (!(opp&e->runouts[i]))
+                        c.add(showdown(hero,evalMask(opp|full)),keyCategory(hero));
+                }
+        }
+    };
+
+public:
+    CardMask hero, villain, board, dead;
+    int threads;
+
+    ///\brief Prepares the enumeration
+    ///@param[in] villain: the opponent's two cards, 0 for a random holding \n
+    ///@param[in] dead: cards known to be out of the deck \n
+    ///\pre \f$ countCards(hero)=2 \wedge countCards(villain) \in \{0,2\} \wedge countCards(board) \leq 5 \f$, all the masks disjoint
+    ///\pre enough cards are left to deal: validEquityCards(hero,villain,board,dead)
+    EquityEnumeration(CardMask hero, CardMask villain, CardMask board, CardMask dead, int threads)
+        : counters(threads), hero(hero), villain(villain), board(board), dead(dead), threads(threads) {
+        //check preconditions
+        assert(countCards(hero)==2);
+        assert(countCards(villain)==0 || countCards(villain)==2);
+        assert(countCards(board)<=5);
+        assert(countCards(hero|villain|board|dead)==countCards(hero)+countCards(villain)+countCards(board)+countCards(dead));
+        contract(validEquityCards(hero,villain,board,dead));
+
+        CardMask used=hero|villain|board|dead;
+        for (int c=0; c<52; c++)
+            if (!(used&cardBit(c))) deck.push_back(c);
+        if (dealable()) cardSubsets(deck,5-countCards(board),runouts);
+    }
+
+    ///\brief True if the deck holds the missing board cards and the opponent's holding (pure function)
+    bool dealable() const {
+        return (int)deck.size()>=5-countCards(board)+(villain ? 0 : 2);
+    }
+
+    ///\brief Runs the enumeration and returns the exact totals, no showdown if too few cards are left (dealable())
+    ///\post every completion is counted once for every opponent holding
+    ShowdownTotals run() {
+        if (!dealable()) return ShowdownTotals();
+        Step step;
+        step.e=this;
+        parallelFor(0,runouts.size(),threads,step,64);
+
+        ShowdownTotals result=counters.snapshot();
+        //check postconditions
+        uint64_t holdings=villain ? 1 : (deck.size()-(5-countCards(board)))*(deck.size()-(5-countCards(board))-1)/2;
+        contract(result.total()==runouts.size()*holdings);
+        return result;
+    }
+
+    ///\brief Totals counted so far, can be called from another thread during run() (pure function)
+    ShowdownTotals snapshot() const {
+        return counters.snapshot();
+    }
+};
+
+///\brief Seconds since an arbitrary moment, for time budgets
+inline double wallClock() {
+    timeval tv;
+    gettimeofday(&tv,0);
+    return tv.tv_sec+tv.tv_usec*1e-6;
+}
+
+///\brief Intermediate or final result of an EquitySimulation
+class EquityEstimate {
+public:
+    ///estimated equity of the hero
+    double equity;
+    ///width of the confidence interval around equity
+    double width;
+    ///deals evaluated so far (an antithetic pair counts two)
+    uint64_t samples;
+    ///time spent so far
+    double seconds;
+    ///showdowns counted so far
+    ShowdownTotals totals;
+    ///true if width dropped below the requested precision
+    bool converged;
+
+    EquityEstimate() {
+        equity=width=seconds=0;
+        samples=0;
+        converged=false;
+    }
+};
+
+///\brief Receives the estimates of a running EquitySimulation
+class EquityListener {
+public:
+    virtual ~EquityListener() {}
+
+    ///\brief Called after every block of rounds, returning false stops the simulation
+    virtual bool update(const EquityEstimate& estimate)=0;
+};
+
+///\brief Binomial coefficients up to 52
+class Binomials {
+public:
+    uint64_t c[53][53];
+
+    Binomials() {
+        for (int n=0; n<=52; n++) {
+            c[n][0]=1;
+            for (int k=1; k<=52; k++)
+                c[n][k]=(n==0) ? 0 : c[n-1][k-1]+c[n-1][k];
+        }
+    }
+};
+
+///\brief \f$ \binom{n}{k} \f$ (pure function)
+///\pre \f$ 0 \leq n,k \leq 52 \f$
+inline uint64_t binomial(int n, int k) {
+    static const Binomials table;
+    assert(n>=0 && n<=52 && k>=0 && k<=52);//check preconditions
+    return table.c[n][k];
+}
+
+///\brief The k-subset of \f$ \{0..n-1\} \f$ of rank r in the combinatorial number system
+///@param[out] out: the k elements, descending \n
+///\pre \f$ r < \binom{n}{k} \f$
+///\post \f$ r=\sum_i \binom{out_i}{k-i} \f$
+inline void unrankSubset(uint64_t r, int n, int k, int* out) {
+    assert(r<binomial(n,k));//check preconditions
+
+    int c=n-1;
+    for (int i=k; i>=1; i--) {
+        while (binomial(c,i)>r) c--;
+        out[k-i]=c;
+        r-=binomial(c,i);
+        c--;
+    }
+}
+
+///\brief Payouts of a draw poker game, for one coin bet
+class Paytable {
+public:
+    ///\brief Categories of the strength keys: the nine of PokerHand::category and five of a kind (evalWild())
+    static const int Categories=10;
+    ///payout of every category (PokerHand::category, 9 for five of a kind)
+    double pays[Categories];
+    ///lowest rank of a paying pair (9 for jacks or better)
+    int minPairRank;
+    ///payout of the royal flush (AKQJX suited)
+    double royal;
+
+    Paytable() : minPairRank(0), royal(0) {
+        std::fill(pays,pays+Categories,0.0);
+    }
+
+    ///\brief Payout of a five card hand given its strength key (pure function)
+    ///\pre key=evalMask(hand) or evalWild(hand,w) of a five card hand
+    double payout(int key) const {
+        int category=keyCategory(key);
+        assert(category>=0 && category<Categories);//check preconditions
+        int rank=(key>>16)&0xF;
+        if (category==1 && rank<minPairRank) return 0;
+        if (category==8 && rank==12) return royal;
+        return pays[category];
+    }
+};
+
+///\brief The full pay "9/6" jacks or better paytable (pure function)
+inline Paytable jacksOrBetter() {
+    Paytable table;
+    double pays[9]={0,1,2,3,4,6,9,25,50};
+    std::copy(pays,pays+9,table.pays);
+    table.minPairRank=9;
+    table.royal=800;
+    return table;
+}
+
+///\brief Exact expected values of the 32 holds of a five card draw hand
+///
+///The solver never enumerates the draws. It keeps, for every set S of 0 to 5 cards, the total payout of the
+///2,598,960 hands holding S. The hands made by keeping H from the dealt hand D are the hands holding H and none of
+///the discarded cards, their total payout is \f$ \sum_{H \subseteq S \subseteq D} (-1)^{|S|-|H|} totals_S \f$
+///(inclusion-exclusion, 243 lookups for the 32 holds).\n
+///Holds are 5 bit indexes: bit i keeps the i-th card of the hand, in the order of the mask bits.
+///The squared payouts are summed the same way, for the variance of the holds.
+class DrawSolver {
+private:
+    Paytable table;
+    ///total payout and squared payout of the hands holding every set of cards, by subset index
+    std::vector<double> totals, squares;
+    ///first subset index of every set size
+    size_t offsets[7];
+    ///\f$ \binom{c}{t+1} \f$: weight of the card c in position t of the subset index
+    size_t terms[5][52];
+
+    ///\brief Index of a card between 0 and 51 following the mask bits (pure function)
+    static int deckIndex(int bit) {
+        return (bit>>4)*13+(bit&15);
+    }
+
+    ///\brief Cards of a five card hand as deck indexes, ascending (pure function)
+    static void handCards(CardMask hand, int* cards) {
+        assert(countCards(hand)==5);//check preconditions
+        for (int i=0; i<5; i++) {
+            int bit=__builtin_ctzll(hand);
+            cards[i]=deckIndex(bit);
+            hand&=hand-1;
+        }
+    }
+
+    ///\brief Subset index (combinatorial number system) of k cards ascending (pure function)
+    size_t subsetIndex(const int* cards, int k) const {
+        size_t result=offsets[k];
+        for (int t=0; t<k; t++)
+            result+=terms[t][cards[t]];
+        return result;
+    }
+
+    ///\brief Sums the payouts of the hands holding card i into the sets whose lowest card is i
+    class Totals {
+    public:
+        DrawSolver* solver;
+
+        void operator()(int i, int) {
+            int other[51];
+            for (int k=0; k<51; k++)
+                other[k]=(k<i) ? k : k+1;
+            int fromDeck[52];
+            for (int bit=0; bit<64; bit++)
+                if ((bit&15)<13) fromDeck[deckIndex(bit)]=bit;
+            CardMask own=(CardMask)1<<fromDeck[i];
+            int subset[5];
+            subset[0]=i;
+            for (int a=0; a<51; a++)
+                for (int b=a+1; b<51; b++)
+                    for (int c=b+1; c<51; c++)
+                        for (int d=c+1; d<51; d++) {
+                            int hand[4]={other[a],other[b],other[c],other[d]};
+                            CardMask m=own|((CardMask)1<<fromDeck[hand[0]])|((CardMask)1<<fromDeck[hand[1]])
+                                |((CardMask)1<<fromDeck[hand[2]])|((CardMask)1<<fromDeck[hand[3]]);
+                            double pay=solver->table.payout(evalMask(m));
+                            if (pay==0) continue;
+                            //the cards above i
+                            int first=0;
+                            while (first<4 && hand[first]<i) first++;
+                            int above=4-first;
+                            for (int s=0; s<(1<<above); s++) {
+                                int k=1;
+                                for (int j=0; j<above; j++)
+                                    if (s&(1<<j)) subset[k++]=hand[first+j];
+                                size_t index=solver->subsetIndex(subset,k);
+                                solver->totals[index]+=pay;
+                                solver->squares[index]+=pay*pay;
+                            }
+                        }
+        }
+    };
+
+public:
+    ///\brief Builds the payout totals of a paytable on many threads
+    ///\pre \f$ threads \geq 1 \f$
+    DrawSolver(const Paytable& table, int threads) : table(table) {
+        assert(threads>=1);//check preconditions
+        offsets[0]=0;
+        for (int k=0; k<=5; k++)
+            offsets[k+1]=offsets[k]+binomial(52,k);
+        for (int t=0; t<5; t++)
+            for (int c=0; c<52; c++)
+                terms[t][c]=binomial(c,t+1);
+        totals.assign(offsets[6],0.0);
+        squares.assign(offsets[6],0.0);
+
+        Totals body;
+        body.solver=this;
+        parallelFor(0,52,threads,body);
+        //every hand holds five cards: it was counted by the five single cards
+        double all=0, all2=0;
+        for (int i=0; i<52; i++) {
+            all+=totals[offsets[1]+i];
+            all2+=squares[offsets[1]+i];
+        }
+        totals[0]=all/5;
+        squares[0]=all2/5;
+    }
+
+    ///\brief The paytable the solver was built for (pure function)
+    const Paytable& paytable() const {
+        return table;
+    }
+
+    ///\brief Expected value of every hold of a five card hand (pure function)
+    ///@param[out] ev: the expected payout of the 32 holds \n
+    ///@param[out] ev2: if not null, the expected squared payout of the 32 holds \n
+    ///@return the best hold
+    ///\pre \f$ countCards(hand)=5 \f$
+    int solve(CardMask hand, double* ev, double* ev2=0) const {
+        int cards[5];
+        handCards(hand,cards);
+        double sq[32];
+        for (int s=0; s<32; s++) {
+            int subset[5], k=0;
+            for (int j=0; j<5; j++)
+                if (s&(1<<j)) subset[k++]=cards[j];
+            size_t index=subsetIndex(subset,k);
+            ev[s]=totals[index];
+            sq[s]=squares[index];
+        }
+        //superset Moebius transform: drop the hands holding a discarded card
+        for (int j=0; j<5; j++)
+            for (int s=0; s<32; s++)
+                if (!(s&(1<<j))) {
+                    ev[s]-=ev[s|(1<<j)];
+                    sq[s]-=sq[s|(1<<j)];
+                }
+        int best=0;
+        for (int s=0; s<32; s++) {
+            double draws=binomial(47,5-__builtin_popcount(s));
+            ev[s]/=draws;
+            if (ev2) ev2[s]=sq[s]/draws;
+            if (ev[s]>ev[best]) best=s;
+        }
+        return best;
+    }
+
+    ///\brief The cards kept by a hold (pure function)
+    static CardMask holdCards(CardMask hand, int hold) {
+        CardMask result=0;
+        for (int j=0; j<5; j++) {
+            CardMask low=hand&(~hand+1);
+            if (hold&(1<<j)) result|=low;
+            hand&=hand-1;
+        }
+        return result;
+    }
+};
+
+///\brief Optimal strategy of a video poker paytable, with its return and variance
+///
+///The best hold is solved once for every one of the 134,459 hands that differ by more than a renaming of the suits,
+///weighted by the number of the 2,598,960 deals it stands for. The table can be saved and reused while the paytable does not change.
+class DrawStrategy {
+private:
+    Paytable table;
+    ///canonical hands (canonicalSuits()) ascending, the number of deals of each one
+    std::vector<CardMask> classes;
+    std::vector<uint32_t> counts;
+    ///best hold of every class, its expected payout and squared payout
+    std::vector<uint8_t> holds;
+    std::vector<double> values, squares;
+
+    ///\brief Solves the canonical hands
+    class Step {
+    public:
+        DrawStrategy* strategy;
+        const DrawSolver* solver;
+
+        void operator()(int i, int) {
+            double ev[32], ev2[32];
+            int best=solver->solve(strategy->classes[i],ev,ev2);
+            strategy->holds[i]=best;
+            strategy->values[i]=ev[best];
+            strategy->squares[i]=ev2[best];
+        }
+    };
+
+public:
+    ///\brief Solves the best hold of every five card hand on many threads
+    ///\pre \f$ threads \geq 1 \f$
+    ///\post classes.size()=134459
+    void compute(const DrawSolver& solver, int threads) {
+        table=solver.paytable();
+        std::vector<CardMask> hands;
+        hands.reserve(2598960);
+        for (CardMask m=(CardMask)0x1F; m; ) {
+            if ((m&0xE000E000E000E000UL)==0) {
+                CardMask c=m;
+                canonicalSuits(&c,1);
+                hands.push_back(c);
+            }
+            //next mask with five bits set
+            CardMask low=m&(~m+1);
+            CardMask ripple=m+low;
+            m=ripple|(((m^ripple)>>2)/low);
+            if (m>>61) break;
+        }
+        assert(hands.size()==2598960);
+        std::sort(hands.begin(),hands.end());
+        classes.clear();
+        counts.clear();
+        for (size_t i=0; i<hands.size(); i++)
+            if (i==0 || hands[i]!=hands[i-1]) {
+                classes.push_back(hands[i]);
+                counts.push_back(1);
+            } else
+                counts.back()++;
+        holds.resize(classes.size());
+        values.resize(classes.size());
+        squares.resize(classes.size());
+
+        Step body;
+        body.strategy=this;
+        body.solver=&solver;
+        parallelFor(0,classes.size(),threads,body,64);
+        assert(classes.size()==134459);//check postconditions
+    }
+
+    ///\brief Expected payout of a deal under optimal play: the return of the game (pure function)
+    double expectedReturn() const {
+        double sum=0;
+        for (size_t i=0; i<classes.size(); i++)
+            sum+=counts[i]*values[i];
+        return sum/2598960;
+    }
+
+    ///\brief Variance of the payout of a deal under optimal play (pure function)
+    double variance() const {
+        double sum=0;
+        for (size_t i=0; i<classes.size(); i++)
+            sum+=counts[i]*squares[i];
+        double r=expectedReturn();
+        return sum/2598960-r*r;
+    }
+
+    ///\brief The best hold of a five card hand and its expected value (pure function)
+    ///\pre compute() or load() succeeded, \f$ countCards(hand)=5 \f$
+    CardMask bestHold(CardMask hand, double& ev) const {
+        static const SuitPermutations perms;
+        CardMask c=hand;
+        canonicalSuits(&c,1);
+        size_t i=std::lower_bound(classes.begin(),classes.end(),c)-classes.begin();
+        assert(i<classes.size() && classes[i]==c);//check preconditions
+        ev=values[i];
+        //rename the suits back
+        CardMask held=DrawSolver::holdCards(c,holds[i]);
+        for (int p=0; p<24; p++)
+            if (permuteSuits(c,perms.perm[p])==hand)
+                return permuteSuits(held,perms.perm[p]);
+        assert(false);
+        return 0;
+    }
+
+    ///\brief Writes the paytable and the strategy in binary format, returns false on errors
+    bool save(const char* path) const {
+        FILE* f=fopen(path,"wb");
+        if (!f) return false;
+        uint64_t n=classes.size();
+        bool ok=fwrite(table.pays,sizeof(double),Paytable::Categories,f)==Paytable::Categories;
+        ok=ok && fwrite(&table.minPairRank,sizeof(int),1,f)==1;
+        ok=ok && fwrite(&table.royal,sizeof(double),1,f)==1;
+        ok=ok && fwrite(&n,sizeof(n),1,f)==1;
+        if (ok && n>0) {
+            ok=fwrite(&classes[0],sizeof(CardMask),n,f)==n;
+            ok=ok && fwrite(&counts[0],sizeof(uint32_t),n,f)==n;
+            ok=ok && fwrite(&holds[0],sizeof(uint8_t),n,f)==n;
+            ok=ok && fwrite(&values[0],sizeof(double),n,f)==n;
+            ok=ok && fwrite(&squares[0],sizeof(double),n,f)==n;
+        }
+        return fclose(f)==0 && ok;
+    }
+
+    ///\brief Reads a strategy written by save() for the same paytable, returns false on errors or another paytable
+    bool load(const char* path, const Paytable& expected) {
+        FILE* f=fopen(path,"rb");
+        if (!f) return false;
+        uint64_t n=0;
+        bool ok=fread(table.pays,sizeof(double),Paytable::Categories,f)==Paytable::Categories;
+        ok=ok && fread(&table.minPairRank,sizeof(int),1,f)==1;
+        ok=ok && fread(&table.royal,sizeof(double),1,f)==1;
+        ok=ok && std::equal(table.pays,table.pays+Paytable::Categories,expected.pays);
+        ok=ok && table.minPairRank==expected.minPairRank && table.royal==expected.royal;
+        ok=ok && fread(&n,sizeof(n),1,f)==1 && n==134459;
+        classes.resize(ok ? n : 0);
+        counts.resize(ok ? n : 0);
+        holds.resize(ok ? n : 0);
+        values.resize(ok ? n : 0);
+        squares.resize(ok ? n : 0);
+        if (ok) {
+            ok=fread(&classes[0],sizeof(CardMask),n,f)==n;
+            ok=ok && fread(&counts[0],sizeof(uint32_t),n,f)==n;
+            ok=ok && fread(&holds[0],sizeof(uint8_t),n,f)==n;
+            ok=ok && fread(&values[0],sizeof(double),n,f)==n;
+            ok=ok && fread(&squares[0],sizeof(double),n,f)==n;
+        }
+        fclose(f);
+        return ok;
+    }
+};
+
+///\brief Chooses the cards of the deals of a simulation
+///
+///A deal takes board+hole distinct positions of a deck of n cards: the first board complete the board, the others are the
+///opponent's cards. Every single deal must be uniformly distributed, samplers differ in how the deals of a batch cover the deck.
+class DealSampler {
+public:
+    virtual ~DealSampler() {}
+
+    ///\brief Deals a batch: the positions of deal i are \f$ pos_{i*(board+hole)} \ldots pos_{(i+1)*(board+hole)-1} \f$
+    ///\pre \f$ board+hole \leq n \f$
+    virtual void deal(int n, int board, int hole, int count, CounterRng& rng, int* pos)=0;
+};
+
+///\brief Independent deals, as drawn from a freshly shuffled deck
+///
+///Deals are made 16 at a time: every lane shuffles its own copy of the deck (positions in parallel arrays) with random words
+///taken from one CounterRng::lanes() call, so the partial Fisher-Yates steps of the lanes run together.
+///The decks and the words live on the stack, the sampler can be shared by threads.
+class UniformSampler : public DealSampler {
+public:
+    ///\pre \f$ board+hole \leq n \leq 52 \f$
+    void deal(int n, int board, int hole, int count, CounterRng& rng, int* pos) {
+        const int L=16;
+        int m=board+hole;
+        assert(m<=n && n<=52);//check preconditions
+
+        uint8_t decks[52*L];
+        uint32_t words[52*L];
+        for (int done=0; done<count; done+=L) {
+            for (int i=0; i<n; i++)
+                for (int l=0; l<L; l++)
+                    decks[i*L+l]=i;
+            rng.lanes(words,m*L);
+            for (int i=0; i<m; i++)
+                for (int l=0; l<L; l++) {
+                    int j=i+CounterRng::scale(words[i*L+l],n-i);
+                    uint8_t tmp=decks[i*L+l];
+                    decks[i*L+l]=decks[j*L+l];
+                    decks[j*L+l]=tmp;
+                }
+            for (int l=0; l<L && done+l<count; l++)
+                for (int i=0; i<m; i++)
+                    pos[(done+l)*m+i]=decks[i*L+l];
+        }
+    }
+};
+
+///\brief Latin hypercube style deals: consecutive deals are dealt from the same shuffled deck
+///
+///A shuffle yields n/(board+hole) disjoint deals, so inside a batch every card is dealt almost the same number of times.
+class LatinHypercubeSampler : public DealSampler {
+public:
+    void deal(int n, int board, int hole, int count, CounterRng& rng, int* pos) {
+        int m=board+hole;
+        assert(m<=n);//check preconditions
+
+        std::vector<int> perm(n);
+        for (int i=0; i<n; i++) perm[i]=i;
+        int next=n;
+        for (int d=0; d<count; d++) {
+            if (next+m>n) {
+                for (int i=n-1; i>0; i--)
+                    std::swap(perm[i],perm[rng.below(i+1)]);
+                next=0;
+            }
+            for (int i=0; i<m; i++)
+                pos[d*m+i]=perm[next++];
+        }
+    }
+};
+
+///\brief Low-discrepancy deals: a randomly shifted van der Corput sequence over the ranks of the deals
+///
+///The ranks \f$ 0 \ldots \binom{n}{board}\binom{n-board}{hole}-1 \f$ number the deals (board first), point i of the sequence
+///is mapped to a rank and unranked in the combinatorial number system. The random shift keeps every deal uniform.
+class LowDiscrepancySampler : public DealSampler {
+public:
+    ///\brief Base 2 radical inverse of i (pure function)
+    static double radicalInverse(unsigned int i) {
+        double f=0.5, r=0;
+        for (; i; i>>=1, f/=2)
+            if (i&1) r+=f;
+        return r;
+    }
+
+    void deal(int n, int board, int hole, int count, CounterRng& rng, int* pos) {
+        int m=board+hole;
+        assert(m<=n);//check preconditions
+
+        uint64_t boards=binomial(n,board), holes=binomial(n-board,hole);
+        double shift=rng.uniform();
+        std::vector<int> b(board+1), h(hole+1), rest(n-board);
+        for (int d=0; d<count; d++) {
+            double u=radicalInverse(d)+shift;
+            if (u>=1) u-=1;
+            uint64_t r=std::min((uint64_t)(u*boards*holes),boards*holes-1);
+            unrankSubset(r/holes,n,board,&b[0]);
+            //the opponent's cards are ranked among the positions left by the board
+            int k=0;
+            for (int p=0; p<n; p++)
+                if (std::find(b.begin(),b.begin()+board,p)==b.begin()+board) rest[k++]=p;
+            unrankSubset(r%holes,n-board,hole,&h[0]);
+            for (int i=0; i<board; i++) pos[d*m+i]=b[i];
+            for (int i=0; i<hole; i++) pos[d*m+board+i]=rest[h[i]];
+        }
+    }
+};
+
+///\brief Monte Carlo equity of two hole cards, running until a precision or a time budget is reached
+///
+///The simulation runs in rounds, every round deals a batch of deals in each of a fixed set of units.
+///With stratified sampling the units are the possible first cards dealt (the first missing board card, or the opponent's
+///first card on a complete board), equally likely, so the estimate is the mean of the unit means. Antithetic sampling pairs every
+///deal with the one taking the mirrored positions of the deck. The sampler chooses the deals of a batch (UniformSampler by default).\n
+///Batch means are independent, the confidence interval is computed from their variance so that samplers spreading the deals
+///of a batch over the deck get the credit for it. The rounds run in growing blocks; after every block the listener receives the estimate,
+///the simulation stops when the interval is narrower than width, when seconds have passed or when maxSamples deals were evaluated.\n
+///Runs are reproducible: the batch of a unit in a round is a block with its own CounterRng stream (seed, round*units+unit),
+///the batch means are summed round after round and the units are reduced in a fixed order. Without a time budget the result of a seed is
+///the same, bit for bit, whatever the number of threads.
+class EquitySimulation {
+private:
+    ///the cards that can be dealt
+    std::vector<int> deck;
+    int boardMissing;
+    int dealt;
+
+    ///sums of the batch means of a unit
+    class Unit {
+    public:
+        uint64_t n;
+        double sum, sum2;
+    };
+    std::vector<Unit> units;
+
+    ///\brief Buffers of a thread, sized once by run(): the steps do not allocate
+    class Scratch {
+    public:
+        std::vector<int> rest, pos, heroKeys, oppKeys;
+        std::vector<CardMask> heroes, opps;
+        std::vector<double> values;
+
+        ///\brief Room for batches of deals of dealt cards from a deck of n cards, with copies of every deal
+        void size(int n, int dealt, int batch, int copies) {
+            rest.reserve(n);
+            pos.resize(batch*dealt+1);
+            heroKeys.resize(copies*batch);
+            oppKeys.resize(copies*batch);
+            heroes.resize(copies*batch);
+            opps.resize(copies*batch);
+            values.resize(copies*batch);
+        }
+    };
+    std::vector<Scratch> scratch;
+    ///batch means of the rounds of a block, unit after unit
+    std::vector<double> means;
+
+    ///\brief Deals a batch in one unit of a round of the block: index i is unit i%units.size() of round first+i/units.size()
+    class Step {
+    public:
+        EquitySimulation* s;
+        ShowdownAccumulator* counters;
+        unsigned int first;
+
+        ///\brief Counts the showdowns of the heroes against the opps of b, the value of each one (1, 0.5, 0) goes to its values
+        void showdowns(Scratch& b, ShowdownCounters& c) {
+            int n=b.heroes.size();
+            evalBatch(&b.heroes[0],&b.heroKeys[0],n);
+            evalBatch(&b.opps[0],&b.oppKeys[0],n);
+            for (int i=0; i<n; i++) {
+                int res=showdown(b.heroKeys[i],b.oppKeys[i]);
+                c.add(res,keyCategory(b.heroKeys[i]));
+                b.values[i]=res==1 ? 1 : (res==0 ? 0.5 : 0);
+            }
+        }
+
+        void operator()(int i, int thread) {
+            ShowdownCounters& c=counters->slot(thread);
+            Scratch& b=s->scratch[thread];
+            int u=i%s->units.size();
+            unsigned int round=first+i/s->units.size();
+
+            //in a stratum the first card is fixed and the sampler deals the rest
+            CardMask runout=0, opp=s->villain;
+            std::vector<int>& rest=b.rest;
+            int board=s->boardMissing, hole=s->dealt-s->boardMissing;
+            rest.clear();
+            if (s->stratified) {
+                if (board>0) {
+                    runout|=cardBit(s->deck[u]);
+                    board--;
+                } else {
+                    opp|=cardBit(s->deck[u]);
+                    hole--;
+                }
+                for (unsigned int i=0; i<s->deck.size(); i++)
+                    if ((int)i!=u) rest.push_back(s->deck[i]);
+            } else
+                rest.insert(rest.end(),s->deck.begin(),s->deck.end());
+
+            int m=board+hole, n=rest.size();
+            std::vector<int>& pos=b.pos;
+            //block (round, u) has its own random stream
+            CounterRng rng(s->seed,(uint64_t)round*s->units.size()+u);
+            s->sampler->deal(n,board,hole,s->batch,rng,&pos[0]);
+
+            //the batch (and its mirror) is evaluated at once
+            int copies=s->antithetic ? 2 : 1;
+            std::vector<CardMask>& heroes=b.heroes;
+            std::vector<CardMask>& opps=b.opps;
+            std::vector<double>& values=b.values;
+            for (int d=0; d<s->batch; d++)
+                for (int k=0; k<copies; k++) {
+                    CardMask r=s->board|runout, o=opp;
+                    for (int i=0; i<m; i++) {
+                        int p=pos[d*m+i];
+                        CardMask card=cardBit(rest[k ? n-1-p : p]);
+                        if (i<board) r|=card;
+                        else o|=card;
+                    }
+                    heroes[copies*d+k]=s->hero|r;
+                    opps[copies*d+k]=o|r;
+                }
+            showdowns(b,c);
+            double sum=0;
+            for (int d=0; d<s->batch; d++) {
+                double v=0;
+                for (int k=0; k<copies; k++)
+                    v+=values[copies*d+k];
+                sum+=v/copies;
+            }
+            s->means[i]=sum/s->batch;
+        }
+    };
+
+    ///\brief Estimate from the units
+    EquityEstimate estimate() {
+        EquityEstimate e;
+        double var=0;
+        for (unsigned int u=0; u<units.size(); u++) {
+            double mean=units[u].sum/units[u].n;
+            e.equity+=mean/units.size();
+            if (units[u].n>1)
+                var+=(units[u].sum2-units[u].n*mean*mean)/(units[u].n-1)/units[u].n;
+        }
+        var/=(double)units.size()*units.size();
+        e.width=2*z*std::sqrt(std::max(var,0.0));
+        return e;
+    }
+
+public:
+    CardMask hero, villain, board, dead;
+    ///requested width of the confidence interval (0 runs until the other limits)
+    double width;
+    ///time budget in seconds (0 for none)
+    double seconds;
+    ///most deals to evaluate
+    uint64_t maxSamples;
+    ///normal quantile of the confidence interval, 1.96 for 95%
+    double z;
+    ///units are the first cards dealt
+    bool stratified;
+    ///deals come in mirrored pairs
+    bool antithetic;
+    ///chooses the deals of the batches, 0 for UniformSampler
+    DealSampler* sampler;
+    ///deals per unit and round (pairs if antithetic)
+    int batch;
+    int threads;
+    uint64_t seed;
+
+    ///\brief Prepares the simulation with default settings
+    ///
+    ///Stratified, antithetic and uniform sampling, batches of 16, width 0.001, no time budget, 100M deals, one thread
+    ///@param[in] villain: the opponent's two cards, 0 for a random holding \n
+    ///@param[in] dead: cards known to be out of the deck \n
+    ///\pre \f$ countCards(hero)=2 \wedge countCards(villain) \in \{0,2\} \wedge countCards(board) \leq 5 \f$, all the masks disjoint
+    ///\pre enough cards are left to deal: validEquityCards(hero,villain,board,dead)
+    EquitySimulation(CardMask hero, CardMask villain, CardMask board, CardMask dead)
+        : hero(hero), villain(villain), board(board), dead(dead) {
+        //check preconditions
+        assert(countCards(hero)==2);
+        assert(countCards(villain)==0 || countCards(villain)==2);
+        assert(countCards(board)<=5);
+        assert(countCards(hero|villain|board|dead)==countCards(hero)+countCards(villain)+countCards(board)+countCards(dead));
+        contract(validEquityCards(hero,villain,board,dead));
+
+        width=0.001;
+        seconds=0;
+        maxSamples=100000000;
+        z=1.96;
+        stratified=true;
+        antithetic=true;
+        sampler=0;
+        batch=16;
+        threads=1;
+        seed=1;
+
+        CardMask used=hero|villain|board|dead;
+        for (int c=0; c<52; c++)
+            if (!(used&cardBit(c))) deck.push_back(c);
+        boardMissing=5-countCards(board);
+        dealt=boardMissing+(villain ? 0 : 2);
+    }
+
+    ///\brief Runs rounds until one of the limits is reached
+    ///
+    ///A block of rounds runs on one pool of threads, blocks double from one round up to about 64K deals.
+    ///Without enough cards left to deal (the precondition of the constructor) nothing is dealt: the estimate is empty.
+    ///@param[in] listener: receives the estimate after every block, can be 0 \n
+    ///\post \f$ 0 \leq result.equity \leq 1 \f$
+    EquityEstimate run(EquityListener* listener=0) {
+        assert(batch>=1);//check preconditions
+        if ((int)deck.size()<dealt) return EquityEstimate();
+
+        double start=wallClock();
+        ShowdownAccumulator counters(threads);
+
+        //nothing to deal: one showdown decides
+        if (dealt==0) {
+            EquityEstimate e;
+            int h=evalMask(hero|board);
+            int res=showdown(h,evalMask(villain|board));
+            counters.slot(0).add(res,keyCategory(h));
+            e.totals=counters.snapshot();
+            e.equity=e.totals.equity();
+            e.samples=1;
+            e.converged=true;
+            if (listener) listener->update(e);
+            return e;
+        }
+
+        UniformSampler uniform;
+        DealSampler* saved=sampler;
+        if (!sampler) sampler=&uniform;
+        Unit zero={0,0,0};
+        units.assign(deck.size(),zero);
+        scratch.assign(threads,Scratch());
+        for (int t=0; t<threads; t++)
+            scratch[t].size(deck.size(),dealt,batch,antithetic ? 2 : 1);
+        Step step;
+        step.s=this;
+        step.counters=&counters;
+        int n=units.size();
+        uint64_t perRound=(uint64_t)n*batch*(antithetic ? 2 : 1);
+        unsigned int most=std::max<uint64_t>(1,(1<<16)/perRound), rounds=1;
+        EquityEstimate e;
+        for (step.first=0; ; step.first+=rounds, rounds=std::min(2*rounds,most)) {
+            //the block does not run far past maxSamples
+            if (e.samples+rounds*perRound>maxSamples)
+                rounds=std::max<uint64_t>(1,(maxSamples-std::min(e.samples,maxSamples)+perRound-1)/perRound);
+            means.resize(rounds*n);
+            parallelFor(0,rounds*n,threads,step);
+            for (unsigned int i=0; i<rounds*n; i++) {
+                Unit& unit=units[i%n];
+                unit.n++;
+                unit.sum+=means[i];
+                unit.sum2+=means[i]*means[i];
+            }
+
+            e=estimate();
+            e.totals=counters.snapshot();
+            e.samples=e.totals.total();
+            e.seconds=wallClock()-start;
+            //the interval needs two batches per unit
+            e.converged=(step.first+rounds>1 && e.width<=width);
+            bool go=!listener || listener->update(e);
+            if (!go || e.converged || e.samples>=maxSamples || (seconds>0 && e.seconds>=seconds)) break;
+        }
+        sampler=saved;
+
+        assert(e.equity>=0 && e.equity<=1);//check postconditions
+        return e;
+    }
+};
+
+///\brief An equity question: the hero's hole cards against a range of opponent holdings
+class EquityQuery {
+public:
+    CardMask hero, board, dead;
+    ///two card holdings of the opponent, empty for any holding
+    std::vector<CardMask> range;
+
+    ///\pre \f$ countCards(hero)=2 \wedge countCards(board) \leq 5 \f$, the masks disjoint
+    EquityQuery(CardMask hero, CardMask board, CardMask dead) : hero(hero), board(board), dead(dead) {
+        //check preconditions
+        assert(countCards(hero)==2 && countCards(board)<=5);
+        assert(!(hero&board) && !(hero&dead) && !(board&dead));
+    }
+};
+
+///\brief Canonical form of an EquityQuery: two queries have the same key if and only if they are isomorphic
+///
+///The words are the hero, the board and the dead cards, then the range as a set of the 1326 holdings.
+///Holdings sharing a card with the others cannot be dealt and are left out.
+class EquityKey {
+public:
+    uint64_t words[24];
+
+    bool operator<(const EquityKey& other) const {
+        return std::lexicographical_compare(words,words+24,other.words,other.words+24);
+    }
+
+    bool operator==(const EquityKey& other) const {
+        return std::equal(words,words+24,other.words);
+    }
+};
+
+///\brief Tables of equityKey(): cards renamed by the suit permutations, indexes of the holdings
+class EquityKeyTables {
+public:
+    ///packed card c with the suits exchanged by permutation p
+    uint8_t cards[24][52];
+    ///index of the holding of two different packed cards, 0 to 1325
+    uint16_t holdings[52][52];
+
+    EquityKeyTables() {
+        SuitPermutations perms;
+        for (int p=0; p<24; p++)
+            for (int c=0; c<52; c++)
+                cards[p][c]=packCard(cardRank(c),perms.perm[p][cardSuit(c)]);
+        int k=0;
+        for (int b=0; b<52; b++) {
+            holdings[b][b]=0;
+            for (int a=0; a<b; a++)
+                holdings[a][b]=holdings[b][a]=k++;
+        }
+        assert(k==1326);//check postcondition
+    }
+};
+
+///\brief Canonical key of a query (pure function)
+///
+///The permutations giving the smallest (hero, board, dead) are found first, the range is renamed only by those.
+///\pre every holding of the range has two cards
+inline EquityKey equityKey(const EquityQuery& q) {
+    static const SuitPermutations perms;
+    static const EquityKeyTables t;
+
+    //packed cards of the holdings that can be dealt
+    CardMask used=q.hero|q.board|q.dead;
+    std::vector<std::pair<int,int> > range;
+    for (unsigned int i=0; i<q.range.size(); i++) {
+        assert(countCards(q.range[i])==2);//check preconditions
+        if (q.range[i]&used) continue;
+        int a=__builtin_ctzll(q.range[i]);
+        int b=__builtin_ctzll(q.range[i]&~cardBit(packCard(a&15,a>>4)));
+        range.push_back(std::make_pair(packCard(a&15,a>>4),packCard(b&15,b>>4)));
+    }
+
+    EquityKey best, cur;
+    bool found=false;
+    for (int p=0; p<24; p++) {
+        cur.words[0]=permuteSuits(q.hero,perms.perm[p]);
+        cur.words[1]=permuteSuits(q.board,perms.perm[p]);
+        cur.words[2]=permuteSuits(q.dead,perms.perm[p]);
+        if (found && std::lexicographical_compare(best.words,best.words+3,cur.words,cur.words+3)) continue;
+        std::fill(cur.words+3,cur.words+24,0);
+        for (unsigned int i=0; i<range.size(); i++) {
+            int h=t.holdings[t.cards[p][range[i].first]][t.cards[p][range[i].second]];
+            cur.words[3+h/64]|=(uint64_t)1<<(h%64);
+        }
+        if (!found || cur<best) best=cur;
+        found=true;
+    }
+    return best;
+}
+
+///\brief Results of equity queries, shared by threads
+///
+///Isomorphic queries share an entry. The key does not hold the settings of the simulation (width, seed, maxSamples):
+///a lookup only serves an estimate whose interval is as narrow as the caller asks, and an entry keeps the narrower
+///of two estimates. Lookups only take the read lock and stamp the entry with an atomic clock;
+///when the cache is full, an insertion evicts the least recently used eighth of the entries.\n
+///Files hold uint64 words: a header (magic number, version, words of a record, number of records), then the records:
+///the 24 words of the key, the last use, equity, width, samples, seconds (doubles by their bits), converged,
+///wins, ties, losses and the 9 categories of the totals.
+class EquityCache {
+private:
+    class Entry {
+    public:
+        EquityEstimate value;
+        uint64_t lastUse;
+    };
+    std::map<EquityKey,Entry> entries;
+    size_t capacity;
+    uint64_t clock, hitCount, missCount;
+    mutable pthread_rwlock_t lock;
+
+    //not copyable
+    EquityCache(const EquityCache&);
+    EquityCache& operator=(const EquityCache&);
+
+    ///\brief Removes the oldest entries, the write lock is held
+    void evict() {
+        std::vector<std::pair<uint64_t,EquityKey> > ages;
+        for (std::map<EquityKey,Entry>::iterator it=entries.begin(); it!=entries.end(); it++)
+            ages.push_back(std::make_pair(it->second.lastUse,it->first));
+        size_t n=std::max(entries.size()/8,(size_t)1);
+        std::nth_element(ages.begin(),ages.begin()+(n-1),ages.end());
+        for (size_t i=0; i<n; i++)
+            entries.erase(ages[i].second);
+    }
+
+    ///\brief Adds an entry or narrows its estimate, the write lock is held
+    void put(const EquityKey& key, const EquityEstimate& value, uint64_t lastUse) {
+        std::map<EquityKey,Entry>::iterator it=entries.find(key);
+        if (it==entries.end() && entries.size()>=capacity) evict();
+        else if (it!=entries.end() && it->second.value.width<=value.width) {
+            it->second.lastUse=std::max(it->second.lastUse,lastUse);
+            return;
+        }
+        Entry& e=entries[key];
+        e.value=value;
+        e.lastUse=lastUse;
+    }
+
+    ///\brief Bits of a double, or the double of bits (pure functions)
+    static uint64_t doubleBits(double d) {
+        uint64_t w;
+        memcpy(&w,&d,sizeof(w));
+        return w;
+    }
+
+    static double bitsDouble(uint64_t w) {
+        double d;
+        memcpy(&d,&w,sizeof(d));
+        return d;
+    }
+
+    ///\brief Words of the file layout of an entry
+    static void pack(const EquityKey& key, uint64_t lastUse, const EquityEstimate& v, uint64_t* record) {
+        std::copy(key.words,key.words+24,record);
+        uint64_t* w=record+24;
+        *w++=lastUse;
+        *w++=doubleBits(v.equity);
+        *w++=doubleBits(v.width);
+        *w++=v.samples;
+        *w++=doubleBits(v.seconds);
+        *w++=v.converged;
+        *w++=v.totals.wins;
+        *w++=v.totals.ties;
+        *w++=v.totals.losses;
+        std::copy(v.totals.categories,v.totals.categories+9,w);
+    }
+
+    ///\brief The entry of a record written by pack()
+    static void unpack(const uint64_t* record, EquityKey& key, uint64_t& lastUse, EquityEstimate& v) {
+        std::copy(record,record+24,key.words);
+        const uint64_t* w=record+24;
+        lastUse=*w++;
+        v.equity=bitsDouble(*w++);
+        v.width=bitsDouble(*w++);
+        v.samples=*w++;
+        v.seconds=bitsDouble(*w++);
+        v.converged=*w++!=0;
+        v.totals.wins=*w++;
+        v.totals.ties=*w++;
+        v.totals.losses=*w++;
+        std::copy(w,w+9,v.totals.categories);
+    }
+
+public:
+    static const uint64_t magic=0x31434550;//"PEC1"
+    ///\brief Version of the file layout, load() rejects the others
+    static const uint64_t version=1;
+    ///\brief Words of a record
+    static const int recordWords=24+10+9;
+
+    ///\brief Cache of at most capacity entries
+    ///\pre \f$ capacity > 0 \f$
+    explicit EquityCache(size_t capacity) : capacity(capacity), clock(0), hitCount(0), missCount(0) {
+        assert(capacity>0);//check preconditions
+        pthread_rwlock_init(&lock,0);
+    }
+
+    ~EquityCache() {
+        pthread_rwlock_destroy(&lock);
+    }
+
+    ///\brief Looks up the result of a query, returns false if it is not cached with an interval at most width wide
+    bool find(const EquityKey& key, double width, EquityEstimate& result) {
+        pthread_rwlock_rdlock(&lock);
+        std::map<EquityKey,Entry>::iterator it=entries.find(key);
+        bool hit=it!=entries.end() && it->second.value.width<=width;
+        if (hit) {
+            result=it->second.value;
+            __atomic_store_n(&it->second.lastUse,__atomic_add_fetch(&clock,1,__ATOMIC_RELAXED),__ATOMIC_RELAXED);
+        }
+        pthread_rwlock_unlock(&lock);
+        __atomic_add_fetch(hit ? &hitCount : &missCount,1,__ATOMIC_RELAXED);
+        return hit;
+    }
+
+    bool find(const EquityQuery& q, double width, EquityEstimate& result) {
+        return find(equityKey(q),width,result);
+    }
+
+    ///\brief Stores the result of a query, unless the cached one is as narrow
+    void insert(const EquityKey& key, const EquityEstimate& result) {
+        pthread_rwlock_wrlock(&lock);
+        put(key,result,++clock);
+        pthread_rwlock_unlock(&lock);
+    }
+
+    void insert(const EquityQuery& q, const EquityEstimate& result) {
+        insert(equityKey(q),result);
+    }
+
+    ///\brief Number of entries
+    size_t size() const {
+        pthread_rwlock_rdlock(&lock);
+        size_t n=entries.size();
+        pthread_rwlock_unlock(&lock);
+        return n;
+    }
+
+    ///\brief Lookups that found their query
+    uint64_t hits() const {
+        return __atomic_load_n(&hitCount,__ATOMIC_RELAXED);
+    }
+
+    ///\brief Lookups that did not find their query
+    uint64_t misses() const {
+        return __atomic_load_n(&missCount,__ATOMIC_RELAXED);
+    }
+
+    ///\brief Writes the entries and their ages to a binary file, returns false on errors
+    bool save(const char* path) const {
+        FILE* f=fopen(path,"wb");
+        if (!f) return false;
+        pthread_rwlock_rdlock(&lock);
+        uint64_t header[4]={magic,version,recordWords,entries.size()}, record[recordWords];
+        bool ok=fwrite(header,sizeof(header),1,f)==1;
+        for (std::map<EquityKey,Entry>::const_iterator it=entries.begin(); ok && it!=entries.end(); it++) {
+            pack(it->first,__atomic_load_n(&it->second.lastUse,__ATOMIC_RELAXED),it->second.value,record);
+            ok=fwrite(record,sizeof(record),1,f)==1;
+        }
+        pthread_rwlock_unlock(&lock);
+        return fclose(f)==0 && ok;
+    }
+
+    ///\brief Adds the entries of a file written by save(), the oldest ones are evicted if they do not fit
+    ///
+    ///Returns false on errors (another magic number, version or record size, a truncated file), the entries read before the error are kept.
+    bool load(const char* path) {
+        FILE* f=fopen(path,"rb");
+        if (!f) return false;
+        uint64_t header[4], record[recordWords];
+        bool ok=fread(header,sizeof(header),1,f)==1 && header[0]==magic && header[1]==version && header[2]==(uint64_t)recordWords;
+        pthread_rwlock_wrlock(&lock);
+        for (uint64_t i=0; ok && i<header[3]; i++) {
+            EquityKey key;
+            uint64_t lastUse;
+            EquityEstimate value;
+            ok=fread(record,sizeof(record),1,f)==1;
+            if (ok) {
+                unpack(record,key,lastUse,value);
+                clock=std::max(clock,lastUse);
+                put(key,value,lastUse);
+            }
+        }
+        pthread_rwlock_unlock(&lock);
+        fclose(f);
+        return ok;
+    }
+};
+
+#endif
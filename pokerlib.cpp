@@ -0,0 +1,13 @@
+///\file pokerlib.cpp
+///\brief The globals of poker.h, defined once for all the programs including it
+
+#include "poker.h"
+
+unsigned int contractRate=POKER_CONTRACT_RATE;
+uint64_t contractChecks=0, contractViolations=0;
+
+__thread unsigned int contractCountdown=0;
+__thread bool contractChecking=false;
+__thread uint64_t contractHand=0;
+
+ShadowVerifier* shadowVerifier=0;
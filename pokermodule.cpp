@@ -0,0 +1,305 @@
+///\file pokermodule.cpp
+///\brief Python extension: batch evaluation and equity, reading NumPy arrays (any buffer) in place
+///
+///Built by 'make python' as the module poker. The hands are either a 1-D array of 8 byte card masks (bit suit*16+rank)
+///or a 2-D array of packed cards (rank*4+suit), 5 to 7 per row, of any integer type; strided views are read without copies.
+///The keys (int32) and categories (int8) are returned as memoryviews, or written into the buffers given as keys and categories.
+///Invalid hands get key and category -1. The GIL is released during the evaluation.
+///\code
+///import numpy, poker
+///cards=numpy.array([[51,47,43,39,35],[0,4,8,12,48]],dtype=numpy.uint8)
+///keys,categories=poker.evaluate(cards,threads=4)
+///keys=numpy.asarray(keys)
+///poker.equity("AS AH","KS KH",board="2C 7D 9H",exact=True)
+///\endcode
+
+#include <Python.h>
+#include "poker.h"
+
+///\brief Hands read in place from a Python buffer
+class HandSource {
+public:
+    const char* data;
+    Py_ssize_t rows, columns, rowStride, columnStride;
+    int itemSize;
+    bool isSigned;
+
+    ///\brief An integer item of the buffer (pure function)
+    long item(const char* p) const {
+        switch (itemSize) {
+        case 1:
+            return isSigned ? (long)*(const int8_t*)p : (long)*(const uint8_t*)p;
+        case 2: {
+            uint16_t v;
+            memcpy(&v,p,2);
+            return isSigned ? (long)(int16_t)v : (long)v;
+        }
+        case 4: {
+            uint32_t v;
+            memcpy(&v,p,4);
+            return isSigned ? (long)(int32_t)v : (long)v;
+        }
+        default: {
+            uint64_t v;
+            memcpy(&v,p,8);
+            return (long)v;
+        }
+        }
+    }
+
+    ///\brief Cards of hand i, 0 if it is not a hand of 5 to 7 different cards (pure function)
+    CardMask hand(Py_ssize_t i) const {
+        const char* row=data+i*rowStride;
+        if (columns==0) {
+            uint64_t m;
+            memcpy(&m,row,8);
+            int n=countCards(m);
+            return (m&~0x1FFF1FFF1FFF1FFFUL) || n<5 || n>7 ? 0 : m;
+        }
+        CardMask m=0;
+        for (Py_ssize_t j=0; j<columns; j++) {
+            long c=item(row+j*columnStride);
+            if (c<0 || c>51 || (m&cardBit(c))) return 0;
+            m|=cardBit(c);
+        }
+        return m;
+    }
+};
+
+///\brief Evaluates a block of hands
+///
+///The rows of the block are appended to the HandBatch of the thread and evaluated at once by HandBatch::Span::evaluate(),
+///a placeholder hand holds the place of an invalid row, which gets -1 afterwards.
+class EvaluateBlock {
+public:
+    static const Py_ssize_t size=4096;
+    const HandSource* source;
+    int* keys;
+    int8_t* categories;
+    ///one batch per thread
+    std::vector<HandBatch>* batches;
+
+    void operator()(int block, int thread) {
+        Py_ssize_t first=(Py_ssize_t)block*size, end=std::min(source->rows,first+size);
+        CardMask masks[size];
+        bool valid[size];
+        for (Py_ssize_t i=first; i<end; i++) {
+            CardMask m=source->hand(i);
+            valid[i-first]=m!=0;
+            masks[i-first]=m ? m : 0x1F;
+        }
+        HandBatch& batch=(*batches)[thread];
+        batch.clear();
+        batch.append(masks,end-first);
+        HandBatch::Span(&batch,0,batch.size()).evaluate(keys+first);
+        for (Py_ssize_t i=first; i<end; i++) {
+            if (!valid[i-first]) keys[i]=-1;
+            categories[i]=valid[i-first] ? keyCategory(keys[i]) : -1;
+        }
+    }
+};
+
+///\brief Reads the format of an integer buffer, false if it is not one
+static bool integerFormat(const Py_buffer& view, bool& isSigned) {
+    const char* f=view.format ? view.format : "B";
+    if (*f=='@' || *f=='=' || *f=='<') f++;
+    if (strlen(f)!=1 || !strchr("bBhHiIlLqQ",*f)) return false;
+    isSigned=islower(*f);
+    return true;
+}
+
+///\brief An output buffer: writable, contiguous, n items of size bytes; a new memoryview of format if object is None
+static PyObject* output(PyObject* object, Py_ssize_t n, Py_ssize_t size, const char* format, Py_buffer& view) {
+    if (object==0 || object==Py_None) {
+        PyObject* bytes=PyByteArray_FromStringAndSize(0,n*size);
+        if (!bytes) return 0;
+        PyObject* raw=PyMemoryView_FromObject(bytes);
+        Py_DECREF(bytes);
+        if (!raw) return 0;
+        object=PyObject_CallMethod(raw,"cast","s",format);
+        Py_DECREF(raw);
+        if (!object) return 0;
+    } else
+        Py_INCREF(object);
+    if (PyObject_GetBuffer(object,&view,PyBUF_WRITABLE|PyBUF_C_CONTIGUOUS)<0) {
+        Py_DECREF(object);
+        return 0;
+    }
+    if (view.itemsize!=size || view.len!=n*size) {
+        PyErr_Format(PyExc_ValueError,"output buffer needs %zd items of %zd bytes",n,size);
+        PyBuffer_Release(&view);
+        Py_DECREF(object);
+        return 0;
+    }
+    return object;
+}
+
+static PyObject* pyEvaluate(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* names[]={"hands","threads","keys","categories",0};
+    PyObject *hands, *keysObject=0, *categoriesObject=0;
+    int threads=1;
+    if (!PyArg_ParseTupleAndKeywords(args,kwargs,"O|iOO",(char**)names,&hands,&threads,&keysObject,&categoriesObject))
+        return 0;
+    if (threads<1) {
+        PyErr_SetString(PyExc_ValueError,"threads must be positive");
+        return 0;
+    }
+
+    Py_buffer in;
+    if (PyObject_GetBuffer(hands,&in,PyBUF_RECORDS_RO)<0) return 0;
+    HandSource source;
+    source.data=(const char*)in.buf;
+    source.itemSize=in.itemsize;
+    const char* error=0;
+    if (!integerFormat(in,source.isSigned) || (in.itemsize!=1 && in.itemsize!=2 && in.itemsize!=4 && in.itemsize!=8))
+        error="hands must be an array of integers";
+    else if (in.ndim==1 && in.itemsize==8) {
+        source.rows=in.shape[0];
+        source.rowStride=in.strides[0];
+        source.columns=source.columnStride=0;
+    } else if (in.ndim==2 && in.shape[1]>=5 && in.shape[1]<=7) {
+        source.rows=in.shape[0];
+        source.rowStride=in.strides[0];
+        source.columns=in.shape[1];
+        source.columnStride=in.strides[1];
+    } else
+        error="hands must be 1-D 8 byte card masks or 2-D rows of 5 to 7 cards";
+    if (!error && source.rows/EvaluateBlock::size>=INT_MAX) error="too many hands";
+    if (error) {
+        PyErr_SetString(PyExc_ValueError,error);
+        PyBuffer_Release(&in);
+        return 0;
+    }
+
+    Py_buffer keysView, categoriesView;
+    PyObject* keys=output(keysObject,source.rows,4,"i",keysView);
+    PyObject* categories=keys ? output(categoriesObject,source.rows,1,"b",categoriesView) : 0;
+    if (!categories) {
+        if (keys) {
+            PyBuffer_Release(&keysView);
+            Py_DECREF(keys);
+        }
+        PyBuffer_Release(&in);
+        return 0;
+    }
+
+    std::vector<HandBatch> batches(threads);
+    EvaluateBlock body;
+    body.source=&source;
+    body.keys=(int*)keysView.buf;
+    body.categories=(int8_t*)categoriesView.buf;
+    body.batches=&batches;
+    int blocks=(int)((source.rows+EvaluateBlock::size-1)/EvaluateBlock::size);
+    Py_BEGIN_ALLOW_THREADS
+    parallelFor(0,blocks,threads,body);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&categoriesView);
+    PyBuffer_Release(&keysView);
+    PyBuffer_Release(&in);
+    PyObject* result=PyTuple_Pack(2,keys,categories);
+    Py_DECREF(keys);
+    Py_DECREF(categories);
+    return result;
+}
+
+///\brief Cards of a Python argument: a mask or a string of cards, false with an exception set on errors
+static bool cardsArgument(PyObject* object, const char* name, CardMask& m) {
+    static const CardParser parser;
+    if (object==0 || object==Py_None) {
+        m=0;
+        return true;
+    }
+    if (PyUnicode_Check(object)) {
+        const char* text=PyUnicode_AsUTF8(object);
+        if (!text) return false;
+        int cards[52];
+        ParseError error;
+        int n=parser.parse(TextView(text),cards,52,error);
+        if (n<0) {
+            PyErr_Format(PyExc_ValueError,"%s, position %ld: %s",name,error.position,error.message);
+            return false;
+        }
+        m=0;
+        for (int i=0; i<n; i++)
+            m|=cardBit(cards[i]);
+        return true;
+    }
+    m=PyLong_AsUnsignedLongLong(object);
+    if (PyErr_Occurred()) return false;
+    if (m&~0x1FFF1FFF1FFF1FFFUL) {
+        PyErr_Format(PyExc_ValueError,"%s is not a card mask",name);
+        return false;
+    }
+    return true;
+}
+
+static PyObject* pyParse(PyObject*, PyObject* args) {
+    PyObject* text;
+    CardMask m;
+    if (!PyArg_ParseTuple(args,"U",&text) || !cardsArgument(text,"cards",m)) return 0;
+    return PyLong_FromUnsignedLongLong(m);
+}
+
+static PyObject* pyEquity(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* names[]={"hero","villain","board","dead","width","seconds","seed","threads","exact",0};
+    PyObject *heroObject, *villainObject=0, *boardObject=0, *deadObject=0;
+    double width=0.001, seconds=0;
+    unsigned long long seed=1;
+    int threads=1, exact=0;
+    if (!PyArg_ParseTupleAndKeywords(args,kwargs,"O|OOOddKip",(char**)names,&heroObject,&villainObject,&boardObject,
+            &deadObject,&width,&seconds,&seed,&threads,&exact))
+        return 0;
+    CardMask hero, villain, board, dead;
+    if (!cardsArgument(heroObject,"hero",hero) || !cardsArgument(villainObject,"villain",villain)
+        || !cardsArgument(boardObject,"board",board) || !cardsArgument(deadObject,"dead",dead))
+        return 0;
+    if (threads<1 || width<0 || seconds<0) {
+        PyErr_SetString(PyExc_ValueError,"threads must be positive, width and seconds not negative");
+        return 0;
+    }
+    if (!validEquityCards(hero,villain,board,dead)) {
+        PyErr_SetString(PyExc_ValueError,"two hero cards, none or two villain cards, at most 5 board cards, all different, "
+            "enough cards left to deal");
+        return 0;
+    }
+
+    ShowdownTotals totals;
+    double result=0, interval=0;
+    Py_BEGIN_ALLOW_THREADS
+    if (exact) {
+        EquityEnumeration e(hero,villain,board,dead,threads);
+        totals=e.run();
+        result=totals.equity();
+    } else {
+        EquitySimulation s(hero,villain,board,dead);
+        s.width=width;
+        s.seconds=seconds;
+        s.seed=seed;
+        s.threads=threads;
+        EquityEstimate e=s.run();
+        totals=e.totals;
+        result=e.equity;
+        interval=e.width;
+    }
+    Py_END_ALLOW_THREADS
+    return Py_BuildValue("{s:d,s:d,s:K,s:K,s:K}","equity",result,"width",interval,"wins",(unsigned long long)totals.wins,
+        "ties",(unsigned long long)totals.ties,"losses",(unsigned long long)totals.losses);
+}
+
+static PyMethodDef methods[]={
+    {"evaluate",(PyCFunction)(void(*)(void))pyEvaluate,METH_VARARGS|METH_KEYWORDS,
+        "evaluate(hands, threads=1, keys=None, categories=None) -> (keys, categories)\n\n"
+        "Strength keys (int32) and categories (int8) of 1-D card masks or 2-D rows of 5 to 7 packed cards, -1 for invalid hands."},
+    {"equity",(PyCFunction)(void(*)(void))pyEquity,METH_VARARGS|METH_KEYWORDS,
+        "equity(hero, villain=None, board=None, dead=None, width=0.001, seconds=0, seed=1, threads=1, exact=False) -> dict\n\n"
+        "Equity of two hole cards against two cards or any holding; cards are masks or strings like 'AS KD'."},
+    {"parse",pyParse,METH_VARARGS,"parse(text) -> card mask of cards like 'AS KD XH'"},
+    {0,0,0,0}
+};
+
+static PyModuleDef module={PyModuleDef_HEAD_INIT,"poker","Poker hand evaluation and equity",-1,methods,0,0,0,0};
+
+PyMODINIT_FUNC PyInit_poker() {
+    return PyModule_Create(&module);
+}
@@ -0,0 +1,677 @@
+///\file pokertest.cpp
+///\brief CppUnit tests of the evaluators against PokerHand, run by 'make test'
+///
+///The tests are exhaustive where the hands can be enumerated in seconds: they are built with the optimizer
+///and with the assertions, so that the contracts of the code under test are checked as well.
+
+#include <set>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include "poker.h"
+
+///\brief The PokerHand of the five cards of m
+///\pre \f$ countCards(m)=5 \f$
+static PokerHand pokerHand(CardMask m, Ruleset rules=StandardDeck) {
+    int r[5], s[5], n=0;
+    for (int c=0; c<52; c++)
+        if (m&cardBit(c)) {
+            r[n]=cardRank(c);
+            s[n++]=cardSuit(c);
+        }
+    assert(n==5);//check preconditions
+    return PokerHand(r[0],s[0],r[1],s[1],r[2],s[2],r[3],s[3],r[4],s[4],rules);
+}
+
+///\brief The key of a PokerHand: its category in the order of its rules above the ranks of its signature
+static int pokerHandKey(const PokerHand& hand, Ruleset rules) {
+    return categoryOrder(hand.getCategory(),rules)<<20|(int)(hand.signature&0xFFFFF);
+}
+
+///\brief The 52 cards, or the 36 of the short deck
+static std::vector<int> deck(Ruleset rules) {
+    std::vector<int> cards;
+    for (int c=(rules==ShortDeck) ? packCard(4,0) : 0; c<52; c++)
+        cards.push_back(c);
+    return cards;
+}
+
+///\brief Best key of the five card subsets of m computed by eval
+template<class Eval>
+static int bestOfFive(CardMask m, Eval eval) {
+    int cards[7], n=0, best=-1;
+    for (int c=0; c<52; c++)
+        if (m&cardBit(c)) cards[n++]=c;
+    for (int a=0; a<n; a++)
+        for (int b=a+1; b<n; b++)
+            for (int c=b+1; c<n; c++)
+                for (int d=c+1; d<n; d++)
+                    for (int e=d+1; e<n; e++)
+                        best=std::max(best,eval(cardBit(cards[a])|cardBit(cards[b])|cardBit(cards[c])|cardBit(cards[d])|cardBit(cards[e])));
+    return best;
+}
+
+///\brief Short deck: evalShortDeck() against PokerHand with the ShortDeck rules
+class ShortDeckTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(ShortDeckTest);
+    CPPUNIT_TEST(testFiveCards);
+    CPPUNIT_TEST(testSevenCards);
+    CPPUNIT_TEST(testWheel);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ///\brief All the 376,992 hands of five cards: same key as PokerHand, so the same order as PokerHand::wins()
+    void testFiveCards() {
+        std::vector<CardMask> hands;
+        cardSubsets(deck(ShortDeck),5,hands);
+        CPPUNIT_ASSERT_EQUAL((size_t)376992,hands.size());
+        for (size_t i=0; i<hands.size(); i++)
+            CPPUNIT_ASSERT_EQUAL(pokerHandKey(pokerHand(hands[i],ShortDeck),ShortDeck),evalShortDeck(hands[i]));
+    }
+
+    ///\brief All the 8,347,680 hands of seven cards: the key of the best of their 21 five card subsets
+    void testSevenCards() {
+        std::vector<CardMask> hands;
+        cardSubsets(deck(ShortDeck),7,hands);
+        CPPUNIT_ASSERT_EQUAL((size_t)8347680,hands.size());
+        for (size_t i=0; i<hands.size(); i++)
+            CPPUNIT_ASSERT_EQUAL(bestOfFive(hands[i],evalShortDeck),evalShortDeck(hands[i]));
+    }
+
+    ///\brief 9876A is the lowest straight, a flush beats a full house
+    void testWheel() {
+        PokerHand wheel(12,0,7,1,6,2,5,3,4,0,ShortDeck), six(8,0,7,2,6,3,5,1,4,1,ShortDeck), trips(12,1,12,2,12,3,7,3,5,0,ShortDeck);
+        CPPUNIT_ASSERT_EQUAL(4,wheel.getCategory());
+        CPPUNIT_ASSERT_EQUAL(2,wheel.wins(six));
+        CPPUNIT_ASSERT_EQUAL(1,wheel.wins(trips));
+        PokerHand flush(12,0,10,0,8,0,6,0,4,0,ShortDeck), fullHouse(12,1,12,2,12,3,11,1,11,2,ShortDeck);
+        CPPUNIT_ASSERT_EQUAL(1,flush.wins(fullHouse));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ShortDeckTest);
+
+///\brief The packed signatures of PokerHand and the keys of evalMask() on all the 2,598,960 hands of five cards
+class FiveCardTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(FiveCardTest);
+    CPPUNIT_TEST(testAllHands);
+    CPPUNIT_TEST(testWins);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ///\brief Same key for PokerHand and evalMask(), the known count of every category and 7462 distinct strengths
+    void testAllHands() {
+        static const int categories[9]={1302540,1098240,123552,54912,10200,5108,3744,624,40};
+        std::vector<CardMask> hands;
+        cardSubsets(deck(StandardDeck),5,hands);
+        CPPUNIT_ASSERT_EQUAL((size_t)2598960,hands.size());
+        int count[9]={0,0,0,0,0,0,0,0,0};
+        std::vector<uint64_t> strengths(hands.size());
+        for (size_t i=0; i<hands.size(); i++) {
+            PokerHand hand=pokerHand(hands[i]);
+            CPPUNIT_ASSERT_EQUAL(pokerHandKey(hand,StandardDeck),evalMask(hands[i]));
+            count[hand.getCategory()]++;
+            strengths[i]=hand.strength();
+        }
+        for (int c=0; c<9; c++)
+            CPPUNIT_ASSERT_EQUAL(categories[c],count[c]);
+        std::sort(strengths.begin(),strengths.end());
+        CPPUNIT_ASSERT_EQUAL(7462L,(long)(std::unique(strengths.begin(),strengths.end())-strengths.begin()));
+    }
+
+    ///\brief wins() of random disjoint hands is the comparison of their strengths, as integers
+    void testWins() {
+        CounterRng rng(59,0);
+        for (int i=0; i<200000; i++) {
+            CardMask a=0, b=0;
+            while (countCards(a)<5)
+                a|=cardBit(rng.below(52));
+            while (countCards(b)<5)
+                b|=cardBit(rng.below(52))&~a;
+            PokerHand x=pokerHand(a), y=pokerHand(b);
+            int expected=(x.strength()>y.strength()) ? 1 : (x.strength()<y.strength()) ? 2 : 0;
+            CPPUNIT_ASSERT_EQUAL(expected,x.wins(y));
+            CPPUNIT_ASSERT_EQUAL(showdown(evalMask(a),evalMask(b)),x.wins(y));
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FiveCardTest);
+
+///\brief Best evalMask() key of m with the wild cards replaced by each set of w cards missing from m
+static int bestSubstitution(CardMask m, int w, int from=0) {
+    if (w==0) return evalMask(m);
+    int best=-1;
+    for (int c=from; c<52; c++)
+        if (!(m&cardBit(c))) best=std::max(best,bestSubstitution(m|cardBit(c),w-1,c+1));
+    return best;
+}
+
+///\brief evalWild() by brute force: five of a kind if the wild cards complete one, otherwise every substitution
+static int bruteForceWild(CardMask m, int w) {
+    for (int r=12; r>=0; r--) {
+        int n=0;
+        for (int s=0; s<4; s++)
+            n+=(m>>(s*16+r))&1;
+        if (n+w>=5) return (9<<20)|(r<<16);
+    }
+    return bestSubstitution(m,w);
+}
+
+///\brief Wild cards: evalWild() and evalDeucesWild() against the brute force over all the substitutions
+class WildTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(WildTest);
+    CPPUNIT_TEST(testJokers);
+    CPPUNIT_TEST(testDeuces);
+    CPPUNIT_TEST(testFiveOfAKind);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ///\brief Random natural cards completed to 5, 6 and 7 cards by one to five jokers
+    void testJokers() {
+        static const int hands[6]={0,2000,1000,200,20,5};
+        CounterRng rng(63,0);
+        for (int w=1; w<=5; w++)
+            for (int i=0; i<hands[w]; i++) {
+                int n=std::max(0,5-w)+rng.below(3);
+                CardMask m=0;
+                while (countCards(m)<n)
+                    m|=cardBit(rng.below(52));
+                CPPUNIT_ASSERT_EQUAL(bruteForceWild(m,w),evalWild(m,w));
+            }
+    }
+
+    ///\brief Random hands of 5 to 7 cards, the 2s being wild
+    void testDeuces() {
+        CounterRng rng(63,1);
+        for (int i=0; i<2000; i++) {
+            CardMask m=0;
+            int n=5+rng.below(3);
+            while (countCards(m)<n)
+                m|=cardBit(rng.below(52));
+            //at least a deuce
+            if (!(m&0x0001000100010001UL)) continue;
+            CardMask deuces=m&0x0001000100010001UL;
+            CPPUNIT_ASSERT_EQUAL(bruteForceWild(m&~deuces,countCards(deuces)),evalDeucesWild(m));
+        }
+    }
+
+    ///\brief Five of a kind beats the royal flush, no wild card is the evaluation of the natural cards
+    void testFiveOfAKind() {
+        CardMask aces=0x1000100010001000UL, royal=0x1F00UL;
+        CPPUNIT_ASSERT_EQUAL(9,keyCategory(evalWild(aces,1)));
+        CPPUNIT_ASSERT(evalWild(aces,1)>evalWild(royal,0));
+        CardMask seven=royal|0x00040004UL;
+        CPPUNIT_ASSERT_EQUAL(evalMask(seven),evalWild(seven,0));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(WildTest);
+
+///\brief Sums the payout and the squared payout of the hands made by adding k cards not in dealt to held
+static void drawTotals(const Paytable& table, CardMask dealt, CardMask held, int k, double& sum, double& sum2, int from=0) {
+    if (k==0) {
+        double p=table.payout(evalMask(held));
+        sum+=p;
+        sum2+=p*p;
+        return;
+    }
+    for (int c=from; c<52; c++)
+        if (!(dealt&cardBit(c))) drawTotals(table,dealt,held|cardBit(c),k-1,sum,sum2,c+1);
+}
+
+///\brief Draw poker: the DrawSolver totals against the enumeration of all the draws, the return of 9/6 jacks or better
+class DrawTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(DrawTest);
+    CPPUNIT_TEST(testAllDraws);
+    CPPUNIT_TEST(testReturn);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ///\brief The 32 holds of random hands and of a dealt royal flush: every draw of the 47 other cards is evaluated
+    void testAllDraws() {
+        Paytable table=jacksOrBetter();
+        DrawSolver solver(table,hardwareThreads());
+        CounterRng rng(64,0);
+        for (int i=0; i<8; i++) {
+            CardMask hand=(i==0) ? 0x1F00UL : 0;
+            while (countCards(hand)<5)
+                hand|=cardBit(rng.below(52));
+            double ev[32], ev2[32];
+            int best=solver.solve(hand,ev,ev2);
+            for (int h=0; h<32; h++) {
+                CardMask held=DrawSolver::holdCards(hand,h);
+                int k=5-countCards(held);
+                double sum=0, sum2=0;
+                drawTotals(table,hand,held,k,sum,sum2);
+                double draws=binomial(47,k);
+                CPPUNIT_ASSERT(fabs(sum/draws-ev[h])<1e-9*std::max(1.0,sum/draws));
+                CPPUNIT_ASSERT(fabs(sum2/draws-ev2[h])<1e-9*std::max(1.0,sum2/draws));
+                CPPUNIT_ASSERT(ev[h]<=ev[best]);
+            }
+            if (i==0) {
+                CPPUNIT_ASSERT_EQUAL(31,best);
+                CPPUNIT_ASSERT_EQUAL(800.0,ev[31]);
+            }
+        }
+    }
+
+    ///\brief Optimal play of all the 2,598,960 deals returns the published 99.5439%
+    void testReturn() {
+        Paytable table=jacksOrBetter();
+        DrawSolver solver(table,hardwareThreads());
+        DrawStrategy strategy;
+        strategy.compute(solver,hardwareThreads());
+        CPPUNIT_ASSERT(fabs(strategy.expectedReturn()-0.995439)<5e-7);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DrawTest);
+
+///\brief Counter-based random numbers: Philox against the known answers of its authors (Random123 kat_vectors)
+class PhiloxTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(PhiloxTest);
+    CPPUNIT_TEST(testKnownAnswers);
+    CPPUNIT_TEST(testStreams);
+    CPPUNIT_TEST_SUITE_END();
+
+    ///\brief Checks block number block of (key, stream) against four words
+    void check(uint64_t key, uint64_t stream, uint64_t block, uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3) {
+        uint32_t out[4];
+        Philox::blocks(key,stream,block,1,out);
+        CPPUNIT_ASSERT_EQUAL(w0,out[0]);
+        CPPUNIT_ASSERT_EQUAL(w1,out[1]);
+        CPPUNIT_ASSERT_EQUAL(w2,out[2]);
+        CPPUNIT_ASSERT_EQUAL(w3,out[3]);
+    }
+
+public:
+    ///\brief philox4x32-10: the 128 bit counter is (block, stream), low words first
+    void testKnownAnswers() {
+        check(0,0,0,0x6627e8d5u,0xe169c58du,0xbc57ac4cu,0x9b00dbd8u);
+        check(~(uint64_t)0,~(uint64_t)0,~(uint64_t)0,0x408f276du,0x41c83b0eu,0xa20bc7c6u,0x6d5451fdu);
+        check(0x299f31d0a4093822UL,0x0370734413198a2eUL,0x85a308d3243f6a88UL,0xd16cfe09u,0x94fdccebu,0x5001e420u,0x24126ea1u);
+    }
+
+    ///\brief next(), at() and lanes() read the same words of a stream, blocks() gives the same words many lanes at a time
+    void testStreams() {
+        const int n=103;
+        uint32_t blocks[4*32], lanes[n+1];
+        Philox::blocks(7,3,0,32,blocks);
+        CounterRng a(7,3), b(7,3);
+        b.lanes(lanes,n);
+        lanes[n]=b.next();
+        for (int i=0; i<n; i++) {
+            CPPUNIT_ASSERT_EQUAL(blocks[i],a.next());
+            CPPUNIT_ASSERT_EQUAL(blocks[i],a.at(i));
+            CPPUNIT_ASSERT_EQUAL(blocks[i],lanes[i]);
+        }
+        //lanes() consumed whole blocks
+        CPPUNIT_ASSERT_EQUAL(blocks[104],lanes[n]);
+        CPPUNIT_ASSERT(CounterRng(7,4).next()!=blocks[0] && CounterRng(8,3).next()!=blocks[0]);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PhiloxTest);
+
+///\brief Equity simulation: a seed gives the same showdowns and estimate whatever the number of threads
+class EquityTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(EquityTest);
+    CPPUNIT_TEST(testThreads);
+    CPPUNIT_TEST_SUITE_END();
+
+    ///\brief Runs 300K deals of hero against villain on board with the given threads
+    EquityEstimate simulate(CardMask hero, CardMask villain, CardMask board, int threads) {
+        EquitySimulation s(hero,villain,board,0);
+        s.width=0;
+        s.maxSamples=300000;
+        s.threads=threads;
+        s.seed=5;
+        return s.run();
+    }
+
+public:
+    ///\brief Aces against kings preflop and against a random holding on a flop, with 1, 2 and 8 threads
+    void testThreads() {
+        CardMask aces=cardBit(48)|cardBit(49), kings=cardBit(44)|cardBit(45), flop=cardBit(0)|cardBit(17)|cardBit(34);
+        for (int i=0; i<2; i++) {
+            EquityEstimate one=simulate(aces,i ? 0 : kings,i ? flop : 0,1);
+            CPPUNIT_ASSERT(one.samples>=300000);
+            int threads[]={2,8};
+            for (int t=0; t<2; t++) {
+                EquityEstimate e=simulate(aces,i ? 0 : kings,i ? flop : 0,threads[t]);
+                CPPUNIT_ASSERT_EQUAL(one.totals.wins,e.totals.wins);
+                CPPUNIT_ASSERT_EQUAL(one.totals.ties,e.totals.ties);
+                CPPUNIT_ASSERT_EQUAL(one.totals.losses,e.totals.losses);
+                for (int c=0; c<9; c++)
+                    CPPUNIT_ASSERT_EQUAL(one.totals.categories[c],e.totals.categories[c]);
+                CPPUNIT_ASSERT_EQUAL(one.samples,e.samples);
+                CPPUNIT_ASSERT_EQUAL(one.equity,e.equity);
+                CPPUNIT_ASSERT_EQUAL(one.width,e.width);
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EquityTest);
+
+///\brief parseHandLines() one token at a time with the tables of CardParser: the hands of the lines, the first error
+static long scalarHandLines(const std::string& text, int handCards, int lineHands, std::vector<CardMask>& hands, ParseError& error) {
+    static const CardParser parser;
+    const int line=handCards*lineHands;
+    size_t tokens=(text.size()+1)/3;
+    CardMask seen=0;
+    for (size_t t=0; t<tokens; t++) {
+        size_t at=3*t;
+        int i=t%line;
+        char expected=(i==line-1) ? '\n' : ' ', sep=(at+2<text.size()) ? text[at+2] : '\n';
+        int c=parser.card(text[at],text[at+1]);
+        if (i==0) seen=0;
+        if (parser.card(text[at],'S')<0) {
+            error.position=at;
+            error.message="bad rank";
+        } else if (parser.card('A',text[at+1])<0) {
+            error.position=at+1;
+            error.message="bad suit";
+        } else if (seen&cardBit(c)) {
+            error.position=at;
+            error.message="duplicated card";
+        } else if (sep!=expected) {
+            error.position=at+2;
+            error.message=(expected==' ') ? "missing blank after card" : "missing new line";
+        } else {
+            seen|=cardBit(c);
+            if (t%handCards==0) hands.push_back(0);
+            hands.back()|=cardBit(c);
+            continue;
+        }
+        //the hands of the wrong line are not kept
+        hands.resize(t/line*lineHands);
+        return -1;
+    }
+    return tokens/line;
+}
+
+///\brief Card parsing: the vectorized token decoders and parseHandLines() against the scalar CardParser
+class ParseTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(ParseTest);
+    CPPUNIT_TEST(testDecoders);
+    CPPUNIT_TEST(testHandLines);
+    CPPUNIT_TEST_SUITE_END();
+
+    ///\brief Random characters, mostly ranks, suits and blanks of both cases
+    static char randomChar(CounterRng& rng) {
+        const char* common="23456789TXJQKAtxjqkaSCDHscdh \n\t,";
+        if (rng.below(8)==0) return (char)rng.below(256);
+        return common[rng.below(strlen(common))];
+    }
+
+    ///\brief Lines of lineHands random hands of handCards cards, no card twice in a line, ranks and suits in random case
+    static std::string randomLines(CounterRng& rng, int lines, int handCards, int lineHands) {
+        const char* ranks="23456789XJQKA";
+        const char* suits="SCDH";
+        std::string text;
+        for (int l=0; l<lines; l++) {
+            CardMask seen=0;
+            for (int i=0; i<handCards*lineHands; i++) {
+                int c;
+                do c=rng.below(52); while (seen&cardBit(c));
+                seen|=cardBit(c);
+                char r=(c/4==8 && rng.below(2)) ? 'T' : ranks[c/4], s=suits[c%4];
+                if (rng.below(2)) r=tolower(r);
+                if (rng.below(2)) s=tolower(s);
+                text+=r;
+                text+=s;
+                text+=(i==handCards*lineHands-1) ? '\n' : ' ';
+            }
+        }
+        return text;
+    }
+
+    ///\brief parseHandLines() and scalarHandLines() agree on text: lines, hands and error
+    void compare(const std::string& text, int handCards, int lineHands) {
+        HandBatch batch;
+        std::vector<CardMask> hands;
+        ParseError error, expected;
+        long lines=parseHandLines(TextView(text.data(),text.size()),handCards,lineHands,batch,error);
+        CPPUNIT_ASSERT_EQUAL(scalarHandLines(text,handCards,lineHands,hands,expected),lines);
+        CPPUNIT_ASSERT_EQUAL(expected.position,error.position);
+        CPPUNIT_ASSERT(expected.message==error.message || !strcmp(expected.message,error.message));
+        CPPUNIT_ASSERT_EQUAL(hands.size(),batch.size());
+        for (size_t i=0; i<hands.size(); i++)
+            CPPUNIT_ASSERT_EQUAL(hands[i],batch.mask(i));
+    }
+
+public:
+    ///\brief decodeTokensSimd() and the SSSE3 and AVX2 kernels decode random texts of every length as decodeTokens()
+    void testDecoders() {
+        CounterRng rng(67,0);
+        uint8_t cards[4][300+8];
+        char seps[4][300+8];
+        for (int n=0; n<300; n++) {
+            std::string text;
+            for (int i=0; i<3*n; i++)
+                text+=randomChar(rng);
+            decodeTokens(text.data(),n,cards[0],seps[0]);
+            decodeTokensSimd(text.data(),n,cards[1],seps[1]);
+            size_t done[4]={(size_t)n,(size_t)n,0,0};
+#ifdef POKER_X86
+            if (__builtin_cpu_supports("ssse3")) done[2]=decodeTokensSsse3(text.data(),n,cards[2],seps[2]);
+            if (__builtin_cpu_supports("avx2")) done[3]=decodeTokensAvx2(text.data(),n,cards[3],seps[3]);
+#endif
+            for (int k=1; k<4; k++) {
+                CPPUNIT_ASSERT(done[k]<=(size_t)n);
+                for (size_t i=0; i<done[k]; i++) {
+                    CPPUNIT_ASSERT_EQUAL(cards[0][i],cards[k][i]);
+                    CPPUNIT_ASSERT_EQUAL(seps[0][i],seps[k][i]);
+                }
+            }
+        }
+    }
+
+    ///\brief Random valid lines, then every column of a line in the first and the second block of 256 lines made wrong
+    void testHandLines() {
+        CounterRng rng(67,1);
+        for (int handCards=5; handCards<=7; handCards++) {
+            //at most 52 different cards in a line
+            int shapes[]={1,2,52/handCards};
+            for (int k=0; k<3; k++) {
+                int lineHands=shapes[k], width=3*handCards*lineHands;
+                std::string text=randomLines(rng,300,handCards,lineHands);
+                compare(text,handCards,lineHands);
+                //the last new line may be missing
+                compare(text.substr(0,text.size()-1),handCards,lineHands);
+                int wrong[]={3,270};
+                for (int l=0; l<2; l++)
+                    for (int column=0; column<width; column++) {
+                        std::string bad=text;
+                        bad[wrong[l]*width+column]=randomChar(rng);
+                        compare(bad,handCards,lineHands);
+                    }
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ParseTest);
+
+///\brief The bytes of a file, which is closed
+static std::string fileBytes(FILE* file) {
+    std::string bytes;
+    rewind(file);
+    for (int c; (c=fgetc(file))!=EOF; )
+        bytes+=(char)c;
+    fclose(file);
+    return bytes;
+}
+
+///\brief A temporary file holding bytes, ready to be read
+static FILE* bytesFile(const std::string& bytes) {
+    FILE* file=tmpfile();
+    fwrite(bytes.data(),1,bytes.size(),file);
+    rewind(file);
+    return file;
+}
+
+///\brief Column files: ColumnReader reads back the blocks of ColumnWriter and rejects truncated or oversized blocks
+class ColumnTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(ColumnTest);
+    CPPUNIT_TEST(testRoundTrip);
+    CPPUNIT_TEST(testCorrupted);
+    CPPUNIT_TEST_SUITE_END();
+
+    ResultColumns results;
+
+    ///\brief The results written in blocks of blockSize
+    std::string written(size_t blockSize) {
+        FILE* file=tmpfile();
+        {
+            ColumnWriter writer(file,blockSize);
+            for (size_t i=0; i<results.size(); i++)
+                writer.write(results.keys[i],results.winners[i]);
+            CPPUNIT_ASSERT(writer.flush());
+        }
+        return fileBytes(file);
+    }
+
+    ///\brief Reads bytes block after block, returns the number of results read
+    size_t readBack(const std::string& bytes, size_t blockSize, bool& corrupted) {
+        FILE* file=bytesFile(bytes);
+        ColumnReader reader(file);
+        ResultColumns block;
+        size_t n=0;
+        while (reader.next(block)) {
+            CPPUNIT_ASSERT(block.size()==blockSize || n+block.size()==results.size());
+            for (size_t i=0; i<block.size(); i++, n++) {
+                CPPUNIT_ASSERT_EQUAL(results.keys[n],block.keys[i]);
+                CPPUNIT_ASSERT_EQUAL(results.categories[n],block.categories[i]);
+                CPPUNIT_ASSERT_EQUAL(results.winners[n],block.winners[i]);
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)0,block.size());
+        corrupted=reader.corrupted();
+        fclose(file);
+        return n;
+    }
+
+public:
+    ///\brief 2500 results: a descending run of keys as rankHands() writes them, then random keys of every category and showdown codes
+    void setUp() {
+        CounterRng rng(69,0);
+        results.clear();
+        for (int i=0; i<1000; i++)
+            results.push_back(9<<20|(1000-i));
+        for (int i=0; i<1500; i++) {
+            //every tenth hand has two wild cards
+            int wild=(i%10==0) ? 2 : 0;
+            CardMask m=0;
+            while (countCards(m)<7-wild)
+                m|=cardBit(rng.below(52));
+            int key=evalWild(m,wild);
+            results.push_back(key,(int)rng.below(4)-1);
+        }
+    }
+
+    ///\brief Blocks of 1, 1000, 64 and maxBlockSize results: many blocks, a partial last block, a single block
+    void testRoundTrip() {
+        size_t sizes[]={1,1000,64,ColumnWriter::maxBlockSize};
+        for (int k=0; k<4; k++) {
+            bool corrupted=true;
+            CPPUNIT_ASSERT_EQUAL(results.size(),readBack(written(sizes[k]),sizes[k],corrupted));
+            CPPUNIT_ASSERT(!corrupted);
+        }
+    }
+
+    ///\brief Every truncation of the file inside a block and a header announcing more than maxBlockSize results stop the reader as corrupted
+    void testCorrupted() {
+        std::string bytes=written(1000);
+        //a file cut between two blocks is a valid shorter file
+        std::set<size_t> ends;
+        for (size_t at=0; at<bytes.size(); ) {
+            uint32_t header[6];
+            memcpy(header,bytes.data()+at,sizeof(header));
+            at+=sizeof(header)+header[2]+header[3]+header[4];
+            ends.insert(at);
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)3,ends.size());
+        for (size_t size=1; size<bytes.size(); size++) {
+            bool corrupted=false;
+            size_t n=readBack(bytes.substr(0,size),1000,corrupted);
+            CPPUNIT_ASSERT(corrupted!=(ends.count(size)==1));
+            CPPUNIT_ASSERT(n<results.size() && n%1000==0);
+        }
+        //a valid header of maxBlockSize+1 results, followed by the bytes it announces
+        uint32_t n=ColumnWriter::maxBlockSize+1;
+        uint32_t header[6]={ColumnWriter::magic,n,(n+1)/2,(n+3)/4,n,0};
+        std::string oversized((const char*)header,sizeof(header));
+        oversized+=std::string((n+1)/2+(n+3)/4,'\0');
+        oversized+=std::string(n,'\0');
+        header[5]=adler32((const unsigned char*)oversized.data()+sizeof(header),oversized.size()-sizeof(header));
+        oversized.replace(0,sizeof(header),(const char*)header,sizeof(header));
+        bool corrupted=false;
+        CPPUNIT_ASSERT_EQUAL((size_t)0,readBack(oversized,1000,corrupted));
+        CPPUNIT_ASSERT(corrupted);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ColumnTest);
+
+///\brief Orders the indexes of keys as RadixSort: higher key first, equal keys by increasing index
+class DescendingKeys {
+public:
+    const std::vector<int>* keys;
+
+    bool operator()(uint32_t a, uint32_t b) const {
+        return (*keys)[a]>(*keys)[b] || ((*keys)[a]==(*keys)[b] && a<b);
+    }
+};
+
+///\brief Radix sort of the strength keys against std::sort, with several threads
+class RadixSortTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(RadixSortTest);
+    CPPUNIT_TEST(testSort);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ///\brief Keys of random 7 card hands (many ties), of flushes only (a skipped pass) and random 24 bit keys, from 0 to 200K keys
+    void testSort() {
+        CounterRng rng(60,0);
+        for (int kind=0; kind<3; kind++) {
+            size_t sizes[]={0,1,2,3,17,255,1000,200000};
+            for (int k=0; k<8; k++) {
+                std::vector<int> keys(sizes[k]);
+                for (size_t i=0; i<keys.size(); i++) {
+                    CardMask m=0;
+                    while (countCards(m)<7)
+                        m|=cardBit(rng.below(52));
+                    if (kind==0) keys[i]=evalMask(m);
+                    else if (kind==1) keys[i]=5<<20|(rng.below(1<<16)&0x1F1F);
+                    else keys[i]=rng.below(1<<24);
+                }
+                std::vector<uint32_t> expected(keys.size());
+                for (size_t i=0; i<keys.size(); i++)
+                    expected[i]=i;
+                DescendingKeys descending;
+                descending.keys=&keys;
+                std::sort(expected.begin(),expected.end(),descending);
+                int threads[]={1,2,3,8};
+                for (int t=0; t<4; t++) {
+                    std::vector<uint32_t> order(keys.size()+1,0xFFFFFFFF);
+                    RadixSort sorter(keys.empty() ? 0 : &keys[0],keys.size(),threads[t]);
+                    sorter.sort(&order[0]);
+                    CPPUNIT_ASSERT_EQUAL(0xFFFFFFFFu,order.back());
+                    order.pop_back();
+                    CPPUNIT_ASSERT(order==expected);
+                }
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RadixSortTest);
+
+int main() {
+    CppUnit::TextUi::TestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+    return runner.run() ? 0 : 1;
+}